@@ -22,4 +22,39 @@ void toggleBit(volatile uint8_t *reg, uint8_t bit);
 // returns the value of the given bit in the given register
 uint8_t readBit(volatile uint8_t *reg, uint8_t bit);
 
+// The following variants are always inlined. With a constant register and bit they fold
+// into single sbi/cbi/sbis instructions, use them on hot paths and keep the functions
+// above for non-constant arguments.
+
+// sets the given bit in the given register to the given value
+static inline void setBitFast(volatile uint8_t *reg, uint8_t bit, uint8_t value) __attribute__((always_inline));
+static inline void setBitFast(volatile uint8_t *reg, uint8_t bit, uint8_t value)
+{
+	if(value)
+		*reg |= (1 << bit);
+	else
+		*reg &= ~(1 << bit);
+}
+
+// sets the given bit in the given register
+static inline void setBitHigh(volatile uint8_t *reg, uint8_t bit) __attribute__((always_inline));
+static inline void setBitHigh(volatile uint8_t *reg, uint8_t bit)
+{
+	*reg |= (1 << bit);
+}
+
+// clears the given bit in the given register
+static inline void setBitLow(volatile uint8_t *reg, uint8_t bit) __attribute__((always_inline));
+static inline void setBitLow(volatile uint8_t *reg, uint8_t bit)
+{
+	*reg &= ~(1 << bit);
+}
+
+// returns the value of the given bit in the given register
+static inline uint8_t readBitFast(volatile uint8_t *reg, uint8_t bit) __attribute__((always_inline));
+static inline uint8_t readBitFast(volatile uint8_t *reg, uint8_t bit)
+{
+	return (*reg >> bit) & 1;
+}
+
 #endif
@@ -7,21 +7,262 @@
 *
 */
 
+#include <avr/pgmspace.h>
+
 #include "display.h"
 
+#ifdef DISP_HOST
+	#include "host/ili9341Emu.h"
+#endif
+
+// 5x8 glyphs for the characters ' ' to '~' followed by the degree sign, one byte per
+// column with the top row in bit 0, left aligned within the glyph width below
+static const uint8_t fontData[FONT_GLYPHS][5] PROGMEM =
+{
+	{0x00, 0x00, 0x00, 0x00, 0x00}, // ' '
+	{0x5F, 0x00, 0x00, 0x00, 0x00}, // '!'
+	{0x07, 0x00, 0x07, 0x00, 0x00}, // '"'
+	{0x14, 0x7F, 0x14, 0x7F, 0x14}, // '#'
+	{0x24, 0x2A, 0x7F, 0x2A, 0x12}, // '$'
+	{0x23, 0x13, 0x08, 0x64, 0x62}, // '%'
+	{0x36, 0x49, 0x55, 0x22, 0x50}, // '&'
+	{0x05, 0x03, 0x00, 0x00, 0x00}, // '\''
+	{0x1C, 0x22, 0x41, 0x00, 0x00}, // '('
+	{0x41, 0x22, 0x1C, 0x00, 0x00}, // ')'
+	{0x08, 0x2A, 0x1C, 0x2A, 0x08}, // '*'
+	{0x08, 0x08, 0x3E, 0x08, 0x08}, // '+'
+	{0x50, 0x30, 0x00, 0x00, 0x00}, // ','
+	{0x08, 0x08, 0x08, 0x08, 0x08}, // '-'
+	{0x60, 0x60, 0x00, 0x00, 0x00}, // '.'
+	{0x20, 0x10, 0x08, 0x04, 0x02}, // '/'
+	{0x3E, 0x51, 0x49, 0x45, 0x3E}, // '0'
+	{0x00, 0x42, 0x7F, 0x40, 0x00}, // '1'
+	{0x42, 0x61, 0x51, 0x49, 0x46}, // '2'
+	{0x21, 0x41, 0x45, 0x4B, 0x31}, // '3'
+	{0x18, 0x14, 0x12, 0x7F, 0x10}, // '4'
+	{0x27, 0x45, 0x45, 0x45, 0x39}, // '5'
+	{0x3C, 0x4A, 0x49, 0x49, 0x30}, // '6'
+	{0x01, 0x71, 0x09, 0x05, 0x03}, // '7'
+	{0x36, 0x49, 0x49, 0x49, 0x36}, // '8'
+	{0x06, 0x49, 0x49, 0x29, 0x1E}, // '9'
+	{0x36, 0x36, 0x00, 0x00, 0x00}, // ':'
+	{0x56, 0x36, 0x00, 0x00, 0x00}, // ';'
+	{0x08, 0x14, 0x22, 0x41, 0x00}, // '<'
+	{0x14, 0x14, 0x14, 0x14, 0x14}, // '='
+	{0x41, 0x22, 0x14, 0x08, 0x00}, // '>'
+	{0x02, 0x01, 0x51, 0x09, 0x06}, // '?'
+	{0x32, 0x49, 0x79, 0x41, 0x3E}, // '@'
+	{0x7E, 0x11, 0x11, 0x11, 0x7E}, // 'A'
+	{0x7F, 0x49, 0x49, 0x49, 0x36}, // 'B'
+	{0x3E, 0x41, 0x41, 0x41, 0x22}, // 'C'
+	{0x7F, 0x41, 0x41, 0x22, 0x1C}, // 'D'
+	{0x7F, 0x49, 0x49, 0x49, 0x41}, // 'E'
+	{0x7F, 0x09, 0x09, 0x01, 0x01}, // 'F'
+	{0x3E, 0x41, 0x41, 0x51, 0x32}, // 'G'
+	{0x7F, 0x08, 0x08, 0x08, 0x7F}, // 'H'
+	{0x41, 0x7F, 0x41, 0x00, 0x00}, // 'I'
+	{0x20, 0x40, 0x41, 0x3F, 0x01}, // 'J'
+	{0x7F, 0x08, 0x14, 0x22, 0x41}, // 'K'
+	{0x7F, 0x40, 0x40, 0x40, 0x40}, // 'L'
+	{0x7F, 0x02, 0x04, 0x02, 0x7F}, // 'M'
+	{0x7F, 0x04, 0x08, 0x10, 0x7F}, // 'N'
+	{0x3E, 0x41, 0x41, 0x41, 0x3E}, // 'O'
+	{0x7F, 0x09, 0x09, 0x09, 0x06}, // 'P'
+	{0x3E, 0x41, 0x51, 0x21, 0x5E}, // 'Q'
+	{0x7F, 0x09, 0x19, 0x29, 0x46}, // 'R'
+	{0x46, 0x49, 0x49, 0x49, 0x31}, // 'S'
+	{0x01, 0x01, 0x7F, 0x01, 0x01}, // 'T'
+	{0x3F, 0x40, 0x40, 0x40, 0x3F}, // 'U'
+	{0x1F, 0x20, 0x40, 0x20, 0x1F}, // 'V'
+	{0x7F, 0x20, 0x18, 0x20, 0x7F}, // 'W'
+	{0x63, 0x14, 0x08, 0x14, 0x63}, // 'X'
+	{0x03, 0x04, 0x78, 0x04, 0x03}, // 'Y'
+	{0x61, 0x51, 0x49, 0x45, 0x43}, // 'Z'
+	{0x7F, 0x41, 0x41, 0x00, 0x00}, // '['
+	{0x02, 0x04, 0x08, 0x10, 0x20}, // '\\'
+	{0x41, 0x41, 0x7F, 0x00, 0x00}, // ']'
+	{0x04, 0x02, 0x01, 0x02, 0x04}, // '^'
+	{0x40, 0x40, 0x40, 0x40, 0x40}, // '_'
+	{0x01, 0x02, 0x04, 0x00, 0x00}, // '`'
+	{0x20, 0x54, 0x54, 0x54, 0x78}, // 'a'
+	{0x7F, 0x48, 0x44, 0x44, 0x38}, // 'b'
+	{0x38, 0x44, 0x44, 0x44, 0x20}, // 'c'
+	{0x38, 0x44, 0x44, 0x48, 0x7F}, // 'd'
+	{0x38, 0x54, 0x54, 0x54, 0x18}, // 'e'
+	{0x08, 0x7E, 0x09, 0x01, 0x02}, // 'f'
+	{0x18, 0xA4, 0xA4, 0xA4, 0x7C}, // 'g'
+	{0x7F, 0x08, 0x04, 0x04, 0x78}, // 'h'
+	{0x44, 0x7D, 0x40, 0x00, 0x00}, // 'i'
+	{0x40, 0x80, 0x84, 0x7D, 0x00}, // 'j'
+	{0x7F, 0x10, 0x28, 0x44, 0x00}, // 'k'
+	{0x41, 0x7F, 0x40, 0x00, 0x00}, // 'l'
+	{0x7C, 0x04, 0x18, 0x04, 0x78}, // 'm'
+	{0x7C, 0x08, 0x04, 0x04, 0x78}, // 'n'
+	{0x38, 0x44, 0x44, 0x44, 0x38}, // 'o'
+	{0xFC, 0x24, 0x24, 0x24, 0x18}, // 'p'
+	{0x18, 0x24, 0x24, 0x18, 0xFC}, // 'q'
+	{0x7C, 0x08, 0x04, 0x04, 0x08}, // 'r'
+	{0x48, 0x54, 0x54, 0x54, 0x20}, // 's'
+	{0x04, 0x3F, 0x44, 0x40, 0x20}, // 't'
+	{0x3C, 0x40, 0x40, 0x20, 0x7C}, // 'u'
+	{0x1C, 0x20, 0x40, 0x20, 0x1C}, // 'v'
+	{0x3C, 0x40, 0x30, 0x40, 0x3C}, // 'w'
+	{0x44, 0x28, 0x10, 0x28, 0x44}, // 'x'
+	{0x9C, 0xA0, 0xA0, 0xA0, 0x7C}, // 'y'
+	{0x44, 0x64, 0x54, 0x4C, 0x44}, // 'z'
+	{0x08, 0x36, 0x41, 0x00, 0x00}, // '{'
+	{0x7F, 0x00, 0x00, 0x00, 0x00}, // '|'
+	{0x41, 0x36, 0x08, 0x00, 0x00}, // '}'
+	{0x08, 0x04, 0x08, 0x10, 0x08}, // '~'
+	{0x06, 0x09, 0x09, 0x06, 0x00}  // '\xb0'
+};
+
+// used columns of each glyph, digits, space and '-' keep the full width to align numbers
+static const uint8_t fontWidth[FONT_GLYPHS] PROGMEM =
+{
+	5, 1, 3, 5, 5, 5, 5, 2, 3, 3, 5, 5, 2, 5, 2, 5,
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 2, 2, 4, 5, 4, 5,
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 3, 5, 5, 5, 5, 5, 5,
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 3, 5, 3, 5, 5,
+	3, 5, 5, 5, 5, 5, 5, 5, 5, 3, 4, 4, 3, 5, 5, 5,
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 3, 1, 3, 5, 4
+};
+
+// init sequence: command, number of parameters, parameters, delay in ms after the command
+// dispInit() stops after each command with a delay, so the caller can use the time
+static const uint8_t initSequence[] PROGMEM =
+{
+	0x01, 0, DISP_RESET_COLD, // software reset
+	0x3A, 1, DISP_COLMOD, 0, // pixel format
+	0x36, 1, 0x00, 0, // memory access control, the rotation is done by setWindow()
+	0x11, 0, 5, // sleep out
+	0x29, 0, 0 // display on, sent after the first screen has been cleared
+};
+
+static uint8_t initPosition; // next entry of the init sequence
+
 void dispWrite(uint8_t sel, uint8_t data)
 {
+#ifdef DISP_HOST
+	emuWrite(sel, data);
+#endif
+	if(sel == DISP_SEL_COM)
+		DISP_COUNT(commands, 1);
+	else
+		DISP_COUNT(data, 1);
+	DISP_DATA_OUT = data;
+	setBitFast(DISP_SEL, sel);
+	setBitLow(DISP_WRITE);
+	setBitHigh(DISP_WRITE);
+}
+
+uint8_t dispInit(void)
+{
+	while(initPosition < sizeof(initSequence))
+	{
+		dispWrite(DISP_SEL_COM, pgm_read_byte(&initSequence[initPosition++]));
+		uint8_t count = pgm_read_byte(&initSequence[initPosition++]);
+		for(; count > 0; count--)
+			dispWrite(DISP_SEL_DAT, pgm_read_byte(&initSequence[initPosition++]));
+		uint8_t delay = pgm_read_byte(&initSequence[initPosition++]);
+		if(delay)
+			return delay;
+	}
+	return 0;
+}
+
+// writes one byte to the data bus, D/CX has to be set already
+static inline void dispStrobe(uint8_t data)
+{
+#ifdef DISP_HOST
+	emuWrite(DISP_SEL_DAT, data);
+#endif
 	DISP_DATA_OUT = data;
-	setBit(DISP_SEL, sel);
-	setBit(DISP_WRITE, 0);
-	setBit(DISP_WRITE, 1);
+	setBitLow(DISP_WRITE);
+	setBitHigh(DISP_WRITE);
+}
+
+// writes one pixel of the given color
+static inline void dispPixel(uint8_t *color)
+{
+	dispStrobe(color[0]);
+	dispStrobe(color[1]);
+#if DISP_PIXEL_BYTES == 3
+	dispStrobe(color[2]);
+#endif
+}
+
+// converts 6 bit channels into the pixel format of the display
+static void packColor(uint8_t *color, uint8_t red, uint8_t green, uint8_t blue)
+{
+#ifdef DISP_RGB565
+	color[0] = ((blue >> 1) << 3) | (green >> 3);
+	color[1] = (green << 5) | (red >> 1);
+#else
+	color[0] = blue << 2;
+	color[1] = green << 2;
+	color[2] = red << 2;
+#endif
+}
+
+void setWindow(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2)
+{
+	// the panel is mounted rotated, x runs along the pages and y along the columns
+	x1 = DISP_MAX_X - x1;
+	y1 = DISP_MAX_Y - y1;
+	x2 = DISP_MAX_X - x2;
+	y2 = DISP_MAX_Y - y2;
+
+	dispWrite(DISP_SEL_COM, 0x2A);
+	dispWrite(DISP_SEL_DAT, y2 >> 8);
+	dispWrite(DISP_SEL_DAT, y2);
+	dispWrite(DISP_SEL_DAT, y1 >> 8);
+	dispWrite(DISP_SEL_DAT, y1);
+
+	dispWrite(DISP_SEL_COM, 0x2B);
+	dispWrite(DISP_SEL_DAT, x2 >> 8);
+	dispWrite(DISP_SEL_DAT, x2);
+	dispWrite(DISP_SEL_DAT, x1 >> 8);
+	dispWrite(DISP_SEL_DAT, x1);
+
+	dispWrite(DISP_SEL_COM, 0x2C);
+	setBitHigh(DISP_SEL); // pixel data follows, only WRX is toggled from here on
+}
+
+// streams the given color into the opened window
+static void streamColor(uint8_t *color, uint32_t count)
+{
+	DISP_COUNT(data, count * DISP_PIXEL_BYTES);
+
+	// unrolled by 8 to keep the loop overhead out of the bus timing
+	for(uint16_t blocks = count >> 3; blocks > 0; blocks--)
+	{
+		dispPixel(color);
+		dispPixel(color);
+		dispPixel(color);
+		dispPixel(color);
+		dispPixel(color);
+		dispPixel(color);
+		dispPixel(color);
+		dispPixel(color);
+	}
+	for(uint8_t rest = count & 7; rest > 0; rest--)
+		dispPixel(color);
+}
+
+void writeColor(uint32_t count)
+{
+	streamColor(dispColor, count);
 }
 
 void setColor(uint8_t red, uint8_t green, uint8_t blue)
 {
-	dispColor[0] = blue << 2;
-	dispColor[1] = green << 2;
-	dispColor[2] = red << 2;
+	packColor(dispColor, red, green, blue);
+}
+
+void setBackColor(uint8_t red, uint8_t green, uint8_t blue)
+{
+	packColor(dispBack, red, green, blue);
 }
 
 void storePosition(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2)
@@ -44,445 +285,186 @@ void storePosition(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2)
 
 void drawPoint(uint16_t x, uint16_t y)
 {
+	DISP_COUNT(points, 1);
 	if(x <= DISP_MAX_X && y <= DISP_MAX_Y)
 	{
-		y = DISP_MAX_Y - y;
-		x = DISP_MAX_X - x;
-
-		dispWrite(DISP_SEL_COM, 0x2A);
-		dispWrite(DISP_SEL_DAT, y >> 8);
-		dispWrite(DISP_SEL_DAT, y);
-		dispWrite(DISP_SEL_DAT, y >> 8);
-		dispWrite(DISP_SEL_DAT, y);
-
-		dispWrite(DISP_SEL_COM, 0x2B);
-		dispWrite(DISP_SEL_DAT, x >> 8);
-		dispWrite(DISP_SEL_DAT, x);
-		dispWrite(DISP_SEL_DAT, x >> 8);
-		dispWrite(DISP_SEL_DAT, x);
-
-		dispWrite(DISP_SEL_COM, 0x2C);
-		dispWrite(DISP_SEL_DAT, dispColor[0]);
-		dispWrite(DISP_SEL_DAT, dispColor[1]);
-		dispWrite(DISP_SEL_DAT, dispColor[2]);
+		setWindow(x, y, x, y);
+		writeColor(1);
+	}
+}
+
+void drawHLine(uint16_t x, uint16_t y, uint16_t length)
+{
+	if(x <= DISP_MAX_X && y <= DISP_MAX_Y && length)
+	{
+		uint16_t x2 = x + length - 1;
+		if(x2 > DISP_MAX_X)
+			x2 = DISP_MAX_X;
+		setWindow(x, y, x2, y);
+		writeColor(x2 - x + 1);
+	}
+}
+
+void drawVLine(uint16_t x, uint16_t y, uint16_t length)
+{
+	if(x <= DISP_MAX_X && y <= DISP_MAX_Y && length)
+	{
+		uint16_t y2 = y + length - 1;
+		if(y2 > DISP_MAX_Y)
+			y2 = DISP_MAX_Y;
+		setWindow(x, y, x, y2);
+		writeColor(y2 - y + 1);
 	}
 }
 
 void drawLine(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2)
 {
+	DISP_COUNT(lines, 1);
 	storePosition(x1, y1, x2, y2);
 	if(x1 == x2)
 	{
 		if(y2 > y1)
-			for(uint16_t y = y1; y <= y2; y++)
-				drawPoint(x1, y);
+			drawVLine(x1, y1, y2 - y1 + 1);
 		else
-			for(uint16_t y = y2; y <= y1; y++)
-				drawPoint(x1, y);
+			drawVLine(x1, y2, y1 - y2 + 1);
 	}
 	else if(y1 == y2)
 	{
-		for(uint16_t x = xStart; x <= xEnd; x++)
-			drawPoint(x,y1);
+		drawHLine(xStart, y1, xEnd - xStart + 1);
 	}
 	else
 	{
-		double m = ((double)yEnd - (double)yStart)/((double)xEnd-(double)xStart);
-		for(uint16_t x = xStart; x <= xEnd; x++)
+		// integer Bresenham, pixels sharing a row (or column) are drawn as one run
+		uint16_t x = xStart;
+		uint16_t y = yStart;
+		uint16_t dx = xEnd - xStart;
+		uint16_t dy;
+		int8_t stepY;
+		if(yEnd > yStart)
+		{
+			dy = yEnd - yStart;
+			stepY = 1;
+		}
+		else
+		{
+			dy = yStart - yEnd;
+			stepY = -1;
+		}
+
+		if(dx >= dy)
 		{
-			double y = (double) yStart;
-			y += m * (double) (x - xStart);
-			drawPoint(x, (uint16_t)y);
+			int16_t error = dx >> 1;
+			uint16_t runStart = xStart;
+			for(; x <= xEnd; x++)
+			{
+				error -= dy;
+				if(error < 0 || x == xEnd)
+				{
+					drawHLine(runStart, y, x - runStart + 1);
+					runStart = x + 1;
+					y += stepY;
+					error += dx;
+				}
+			}
+		}
+		else
+		{
+			int16_t error = dy >> 1;
+			uint16_t runStart = yStart;
+			for(uint16_t i = 0; i <= dy; i++)
+			{
+				error -= dx;
+				if(error < 0 || i == dy)
+				{
+					if(stepY > 0)
+						drawVLine(x, runStart, y - runStart + 1);
+					else
+						drawVLine(x, y, runStart - y + 1);
+					runStart = y + stepY;
+					x++;
+					error += dy;
+				}
+				y += stepY;
+			}
 		}
 	}
 }
 
 void drawRect(uint16_t x, uint16_t y, uint16_t sizeX, uint16_t sizeY)
 {
-	drawLine(x, y, x+sizeX-1, y);
-	drawLine(x+sizeX-1, y, x+sizeX-1, y+sizeY-1);
-	drawLine(x+sizeX-1, y+sizeY-1, x, y+sizeY-1);
-	drawLine(x, y+sizeY-1, x, y);
+	drawHLine(x, y, sizeX);
+	drawHLine(x, y+sizeY-1, sizeX);
+	drawVLine(x, y, sizeY);
+	drawVLine(x+sizeX-1, y, sizeY);
 }
 
 void fillRect(uint16_t x, uint16_t y, uint16_t sizeX, uint16_t sizeY)
 {
-	for(uint16_t curX = x; curX < (x+sizeX); curX++)
-		for(uint16_t curY = y; curY < (y+sizeY); curY++)
-			drawPoint(curX, curY);
+	fillRect2(x, y, sizeX, sizeY);
 }
 
 void fillRect2(uint16_t x, uint16_t y, uint16_t sizeX, uint16_t sizeY)
 {
-	if(x <= DISP_MAX_X && y <= DISP_MAX_Y)
+	DISP_COUNT(fills, 1);
+	if(x <= DISP_MAX_X && y <= DISP_MAX_Y && sizeX && sizeY)
 	{
-		uint16_t x2 = x + sizeX;
+		uint16_t x2 = x + sizeX - 1;
 		if(x2 > DISP_MAX_X)
 			x2 = DISP_MAX_X;
 
-		uint16_t y2 = y + sizeY;
+		uint16_t y2 = y + sizeY - 1;
 		if(y2 > DISP_MAX_Y)
 			y2 = DISP_MAX_Y;
 
-		x = DISP_MAX_X - x;
-		y = DISP_MAX_Y - y;
-		x2 = DISP_MAX_X - x2;
-		y2 = DISP_MAX_Y - y2;
-
-		dispWrite(DISP_SEL_COM, 0x2A);
-		dispWrite(DISP_SEL_DAT, y2 >> 8);
-		dispWrite(DISP_SEL_DAT, y2);
-		dispWrite(DISP_SEL_DAT, y >> 8);
-		dispWrite(DISP_SEL_DAT, y);
-
-		dispWrite(DISP_SEL_COM, 0x2B);
-		dispWrite(DISP_SEL_DAT, x2 >> 8);
-		dispWrite(DISP_SEL_DAT, x2);
-		dispWrite(DISP_SEL_DAT, x >> 8);
-		dispWrite(DISP_SEL_DAT, x);
-
-		dispWrite(DISP_SEL_COM, 0x2C);
-		dispWrite(DISP_SEL_DAT, dispColor[0]);
-		dispWrite(DISP_SEL_DAT, dispColor[1]);
-		dispWrite(DISP_SEL_DAT, dispColor[2]);
-
-		for(uint16_t curX = 0; curX < sizeX; curX++)
-		{
-			for(uint16_t curY = 0; curY < sizeY; curY++)
-			{
-				dispWrite(DISP_SEL_COM, 0x3C);
-				dispWrite(DISP_SEL_DAT, dispColor[0]);
-				dispWrite(DISP_SEL_DAT, dispColor[1]);
-				dispWrite(DISP_SEL_DAT, dispColor[2]);
-			}
-		}
+		setWindow(x, y, x2, y2);
+		writeColor((uint32_t)(x2 - x + 1) * (y2 - y + 1));
 	}
 }
 
+// returns the glyph of a character, unknown characters are shown as '?'
+static uint8_t glyphIndex(char value)
+{
+	uint8_t index = (uint8_t)value - ' ';
+	if((uint8_t)value == FONT_DEGREE)
+		index = FONT_GLYPHS - 1;
+	else if(index >= FONT_GLYPHS - 1)
+		index = '?' - ' ';
+	return index;
+}
+
+// returns the width of a character cell in pixels
+static uint8_t glyphSize(char value)
+{
+	return pgm_read_byte(&fontWidth[glyphIndex(value)]) * FONT_SCALE + FONT_SPACING;
+}
+
 void drawChar(uint16_t x, uint16_t y, char value)
 {
-	switch(value)
+	uint8_t index = glyphIndex(value);
+	uint8_t width = pgm_read_byte(&fontWidth[index]);
+	uint16_t sizeX = width * FONT_SCALE + FONT_SPACING;
+	charX += sizeX;
+	DISP_COUNT(chars, 1);
+
+	if(x + sizeX - 1 > DISP_MAX_X || y < FONT_ASCENT || y - FONT_ASCENT + FONT_HEIGHT - 1 > DISP_MAX_Y)
+		return;
+
+	// the window is filled from the right column to the left one, each column bottom-up
+	setWindow(x, y - FONT_ASCENT, x + sizeX - 1, y - FONT_ASCENT + FONT_HEIGHT - 1);
+	streamColor(dispBack, FONT_SPACING * FONT_HEIGHT);
+	DISP_COUNT(data, (uint16_t)width * FONT_SCALE * FONT_HEIGHT * DISP_PIXEL_BYTES);
+	for(uint8_t column = width; column > 0; column--)
 	{
-		case '':
-			drawRect(x,y-14,3,3);
-			charX += 5;
-			break;
-		case ' ':
-			charX += 11;
-			break;
-		case '!':
-			drawLine(x,y-4,x,y-14);
-			drawLine(x,y,x,y-1);
-			charX += 3;
-			break;
-		case '%':
-			drawRect(x,y-14,3,3);
-			drawRect(x+8,y-2,3,3);
-			drawLine(x,y,x+10,y-14);
-			charX += 13;
-			break;
-		case '-':
-			drawLine(x+1,y-7,x+9,y-7);
-			charX += 13;
-			break;
-		case '.':
-			fillRect(x,y-1,2,2);
-			charX += 4;
-			break;
-		case '0':
-			drawRect(x,y-14,11,15);
-			charX += 13;
-			break;
-		case '1':
-			drawLine(x+10,y-14,x+10,y);
-			charX += 13;
-			break;
-		case '2':
-			drawLine(x,y-14,x+10,y-14);
-			drawLine(x+10,y-14,x+10,y-7);
-			drawLine(x,y-7,x+10,y-7);
-			drawLine(x,y-7,x,y);
-			drawLine(x,y,x+10,y);
-			charX += 13;
-			break;
-		case '3':
-			drawLine(x+10,y,x+10,y-14);
-			drawLine(x,y-14,x+10,y-14);
-			drawLine(x,y-7,x+10,y-7);
-			drawLine(x,y,x+10,y);
-			charX += 13;
-			break;
-		case '4':
-			drawLine(x,y-14,x,y-7);
-			drawLine(x,y-7,x+10,y-7);
-			drawLine(x+10,y-14,x+10,y);
-			charX += 13;
-			break;
-		case '5':
-			drawLine(x+10,y-14,x,y-14);
-			drawLine(x,y-14,x,y-7);
-			drawLine(x,y-7,x+10,y-7);
-			drawLine(x+10,y-7,x+10,y);
-			drawLine(x+10,y,x,y);
-			charX += 13;
-			break;
-		case '6':
-			drawRect(x,y-7,11,8);
-			drawLine(x,y-7,x,y-14);
-			drawLine(x,y-14,x+10,y-14);
-			charX += 13;
-			break;
-		case '7':
-			drawLine(x,y-7,x,y-14);
-			drawLine(x,y-14,x+10,y-14);
-			drawLine(x+10,y-14,x+10,y);
-			charX += 13;
-			break;
-		case '8':
-			drawRect(x,y-14,11,8);
-			drawRect(x,y-7,11,8);
-			charX += 13;
-			break;
-		case '9':
-			drawRect(x,y-14,11,8);
-			drawLine(x+10,y-7,x+10,y);
-			drawLine(x+10,y,x,y);
-			charX += 13;
-			break;
-		case ':':
-			fillRect(x,y-5,2,2);
-			fillRect(x,y-10,2,2);
-			charX += 4;
-			break;
-		case 'A':
-			drawLine(x,y,x,y-12);
-			drawLine(x+10,y,x+10,y-12);
-			drawLine(x,y-7,x+10,y-7);
-			drawLine(x+2,y-14,x+8,y-14);
-			drawPoint(x+1,y-13);
-			drawPoint(x+9,y-13);
-			charX += 13;
-			break;
-		case 'B':
-			drawLine(x,y,x,y-14);
-			drawLine(x,y,x+9,y);
-			drawLine(x,y-7,x+9,y-7);
-			drawLine(x,y-14,x+9,y-14);
-			drawLine(x+10,y-2,x+10,y-5);
-			drawLine(x+10,y-9,x+10,y-12);
-			drawPoint(x+9,y-1);
-			drawPoint(x+9,y-6);
-			drawPoint(x+9,y-8);
-			drawPoint(x+9,y-13);
-			charX += 13;
-			break;
-		case 'C':
-			drawLine(x,y,x+10,y);
-			drawLine(x,y-14,x+10,y-14);
-			drawLine(x,y,x,y-14);
-			charX += 13;
-			break;
-		case 'D':
-			break;
-		case 'E':
-			break;
-		case 'F':
-			break;
-		case 'G':
-			drawLine(x,y,x,y-14);
-			drawLine(x+1,y-14,x+10,y-14);
-			drawLine(x+10,y-13,x+10,y-12);
-			drawLine(x+1,y,x+10,y);
-			drawLine(x+10,y-1,x+10,y-7);
-			drawLine(x+9,y-7,x+4,y-7);
-			drawPoint(x+9,y-6);
-			charX += 13;
-			break;
-		case 'H':
-			drawLine(x,y,x,y-14);
-			drawLine(x, y-7,x+10,y-7);
-			drawLine(x+10,y,x+10,y-14);
-			charX += 13;
-			break;
-		case 'I':
-			break;
-		case 'J':
-			break;
-		case 'K':
-			break;
-		case 'L':
-			drawLine(x,y,x+10,y);
-			drawLine(x,y,x,y-14);
-			charX += 13;
-			break;
-		case 'M':
-			break;
-		case 'N':
-			drawLine(x,y,x,y-14);
-			drawLine(x, y-14,x+10,y);
-			drawLine(x+10,y,x+10,y-14);
-			charX += 13;
-			break;
-		case 'O':
-			drawRect(x,y-14,11,15);
-			charX += 13;
-			break;
-		case 'P':
-			break;
-		case 'Q':
-			break;
-		case 'R':
-			drawRect(x,y-14,11,7);
-			drawLine(x,y-8,x,y);
-			drawPoint(x+1,y-8);
-			drawLine(x+2,y-8,x+10,y);
-			charX += 13;
-			break;
-		case 'S':
-			break;
-		case 'T':
-			drawLine(x,y-14,x+10,y-14);
-			drawLine(x+5,y,x+5,y-14);
-			charX += 13;
-			break;
-		case 'U':
-			drawLine(x,y-14,x,y);
-			drawLine(x+10,y-14,x+10,y);
-			drawLine(x,y,x+10,y);
-			charX += 13;
-			break;
-		case 'V':
-			break;
-		case 'W':
-			break;
-		case 'X':
-			break;
-		case 'Y':
-			break;
-		case 'Z':
-			break;
-		case 'a':
-			drawRect(x,y-4,9,5);
-			drawLine(x+8,y-4,x+8,y-8);
-			drawLine(x,y-8,x+8,y-8);
-			drawPoint(x,y-7);
-			charX += 11;
-			break;
-		case 'b':
-			break;
-		case 'c':
-			drawLine(x,y,x+8,y);
-			drawLine(x,y-8,x+8,y-8);
-			drawLine(x,y,x,y-8);
-			charX += 11;
-			break;
-		case 'd':
-			drawRect(x,y-8,9,9);
-			drawLine(x+8,y-12,x+8,y);
-			charX += 11;
-			break;
-		case 'e':
-			drawLine(x,y,x+8,y);
-			drawLine(x,y-4,x+8,y-4);
-			drawLine(x,y-8,x+8,y-8);
-			drawLine(x,y,x,y-8);
-			drawLine(x+8,y-4,x+8,y-8);
-			charX += 11;
-			break;
-		case 'f':
-			drawLine(x+2,y,x+2,y-13);
-			drawLine(x,y-8,x+4,y-8);
-			drawLine(x+2,y-13,x+6,y-13);
-			charX += 9;
-			break;
-		case 'g':
-			drawLine(x,y,x+7,y);
-			drawLine(x,y,x,y-8);
-			drawLine(x,y-8,x+7,y-8);
-			drawLine(x+7,y-9,x+7,y+4);
-			drawLine(x,y+4,x+7,y+4);
-			charX += 9;
-			break;
-		case 'h':
-			drawLine(x,y,x,y-14);
-			drawLine(x,y-8,x+6,y-8);
-			drawLine(x+6,y-8,x+6,y);
-			charX += 9;
-			break;
-		case 'i':
-			drawLine(x,y,x,y-8);
-			drawPoint(x,y-10);
-			charX += 3;
-			break;
-		case 'j':
-			break;
-		case 'k':
-			break;
-		case 'l':
-			drawLine(x,y,x,y-14);
-			charX += 3;
-			break;
-		case 'm':
-			drawLine(x,y-9,x,y);
-			drawLine(x+4,y-8,x+4,y);
-			drawLine(x+8,y-8,x+8,y);
-			drawLine(x,y-8,x+8,y-8);
-			charX += 11;
-			break;
-		case 'n':
-			drawLine(x,y,x,y-9);
-			drawLine(x,y-8,x+7,y-8);
-			drawLine(x+7,y-8,x+7,y);
-			charX += 10;
-			break;
-		case 'o':
-			drawRect(x,y-8,9,9);
-			charX += 11;
-			break;
-		case 'p':
-			drawLine(x,y-9,x,y+4);
-			drawLine(x,y-8,x+7,y-8);
-			drawLine(x+7,y-8,x+7,y);
-			drawLine(x+7,y,x,y);
-			charX += 9;
-			break;
-		case 'q':
-			break;
-		case 'r':
-			drawLine(x,y,x,y-9);
-			drawLine(x,y-8,x+7,y-8);
-			drawLine(x+7,y-8,x+7,y-6);
-			charX += 10;
-			break;
-		case 's':
-			break;
-		case 't':
-			drawLine(x+2,y,x+2,y-10);
-			drawLine(x,y-8,x+4,y-8);
-			drawLine(x+2,y,x+6,y);
-			charX += 9;
-			break;
-		case 'u':
-			drawLine(x,y,x,y-8);
-			drawLine(x,y,x+8,y);
-			drawLine(x+8,y-8,x+8,y);
-			charX += 11;
-			break;
-		case 'v':
-			break;
-		case 'w':
-			drawLine(x,y-8,x,y);
-			drawLine(x+4,y-7,x+4,y);
-			drawLine(x+8,y-8,x+8,y);
-			drawLine(x,y,x+8,y);
-			charX += 11;
-			break;
-		case 'x':
-			break;
-		case 'y':
-			break;
-		case 'z':
-			break;
+		uint8_t bits = pgm_read_byte(&fontData[index][column - 1]);
+		for(uint8_t repeatX = 0; repeatX < FONT_SCALE; repeatX++)
+		{
+			for(uint8_t mask = 0x80; mask; mask >>= 1)
+			{
+				uint8_t *color = (bits & mask) ? dispColor : dispBack;
+				for(uint8_t repeatY = 0; repeatY < FONT_SCALE; repeatY++)
+					dispPixel(color);
+			}
+		}
 	}
 }
 
@@ -492,3 +474,73 @@ void drawString(uint16_t x, uint16_t y, char *value, uint8_t length)
 	for(uint8_t i = 0; i < length; i++)
 		drawChar(charX, y, value[i]);
 }
+
+void drawTextField(uint16_t x, uint16_t y, uint16_t width, char *value, uint8_t length)
+{
+	drawString(x, y, value, length);
+
+	// clear the rest of the field instead of erasing the previous text first
+	uint16_t x2 = x + width - 1;
+	if(x2 > DISP_MAX_X)
+		x2 = DISP_MAX_X;
+	if(charX <= x2 && y >= FONT_ASCENT && y - FONT_ASCENT + FONT_HEIGHT - 1 <= DISP_MAX_Y)
+	{
+		setWindow(charX, y - FONT_ASCENT, x2, y - FONT_ASCENT + FONT_HEIGHT - 1);
+		streamColor(dispBack, (uint32_t)(x2 - charX + 1) * FONT_HEIGHT);
+	}
+}
+
+void drawTextCached(uint16_t x, uint16_t y, uint16_t width, char *value, uint8_t length, textCache *cache)
+{
+	if(length != cache->length)
+		drawTextField(x, y, width, value, length);
+	else
+	{
+		// unchanged cells are skipped, until a glyph of another width moves the rest of the text
+		charX = x;
+		uint8_t i = 0;
+		for(; i < length; i++)
+		{
+			if(value[i] == cache->text[i])
+				charX += glyphSize(value[i]);
+			else if(glyphSize(value[i]) == glyphSize(cache->text[i]))
+				drawChar(charX, y, value[i]);
+			else
+				break;
+		}
+		if(i < length)
+			drawTextField(charX, y, width - (charX - x), value + i, length - i);
+	}
+
+	cache->length = 0;
+	if(length <= FIELD_CHARS)
+	{
+		for(uint8_t i = 0; i < length; i++)
+			cache->text[i] = value[i];
+		cache->length = length;
+	}
+}
+
+void setScrollArea(uint16_t left, uint16_t right)
+{
+	// the panel scrolls along its pages, which is the x axis of the rotated screen
+	scrollFixed = right;
+	scrollSize = DISP_MAX_X + 1 - left - right;
+
+	dispWrite(DISP_SEL_COM, 0x33);
+	dispWrite(DISP_SEL_DAT, right >> 8);
+	dispWrite(DISP_SEL_DAT, right);
+	dispWrite(DISP_SEL_DAT, scrollSize >> 8);
+	dispWrite(DISP_SEL_DAT, scrollSize);
+	dispWrite(DISP_SEL_DAT, left >> 8);
+	dispWrite(DISP_SEL_DAT, left);
+	setScrollOffset(0);
+}
+
+void setScrollOffset(uint16_t offset)
+{
+	uint16_t start = scrollFixed + offset;
+	dispWrite(DISP_SEL_COM, 0x37);
+	dispWrite(DISP_SEL_DAT, start >> 8);
+	dispWrite(DISP_SEL_DAT, start);
+}
@@ -29,23 +29,80 @@
 	#define DISP_SEL_COM 0
 	#define DISP_SEL_DAT 1
 
+	#define DISP_RESET_COLD 5 // wait after a software reset in ms, the panel was sleeping
+	#define DISP_RESET_WARM 120 // wait after a software reset in ms, the panel may have been awake
+
 	#define DISP_MAX_X 319
 	#define DISP_MAX_Y 239
 
-	uint8_t dispColor[3]; // buffer for display color
+	#define FONT_GLYPHS 96 // ' ' to '~' and the degree sign
+	#define FONT_DEGREE 0xB0 // degree sign in ISO-8859-1
+	#define FONT_SCALE 2 // size of a font pixel on the display
+	#define FONT_SPACING 2 // empty columns after each glyph
+	#define FONT_HEIGHT (8 * FONT_SCALE) // height of a character cell
+	#define FONT_ASCENT (7 * FONT_SCALE - 1) // rows of a character cell above the base line
+
+	#define FIELD_CHARS 5 // longest text of a field that is redrawn by differences
+
+	typedef struct
+	{
+		uint8_t length; // length of the drawn text, 0 to redraw the whole field
+		char text[FIELD_CHARS]; // text as drawn on the display
+	} textCache;
+
+	// pixel format, define DISP_RGB565 for 16 bit pixels (5-6-5), otherwise 18 bit pixels (6-6-6) are used
+	#ifdef DISP_RGB565
+		#define DISP_PIXEL_BYTES 2
+		#define DISP_COLMOD 0x55
+	#else
+		#define DISP_PIXEL_BYTES 3
+		#define DISP_COLMOD 0x66
+	#endif
+
+	uint8_t dispColor[DISP_PIXEL_BYTES]; // buffer for display color
+	uint8_t dispBack[DISP_PIXEL_BYTES]; // buffer for display background color
+
+	// define DISP_STATS to count the bus writes and drawing calls of the driver
+	#ifdef DISP_STATS
+		typedef struct
+		{
+			uint32_t commands; // command writes
+			uint32_t data; // data writes
+			uint32_t points; // calls of drawPoint()
+			uint32_t lines; // calls of drawLine()
+			uint32_t fills; // calls of fillRect2()
+			uint32_t chars; // calls of drawChar()
+		} dispStatistics;
+
+		dispStatistics dispStats; // counters since start or the last reset
+		#define DISP_COUNT(counter, value) (dispStats.counter += (value))
+	#else
+		#define DISP_COUNT(counter, value) ((void)0)
+	#endif
 
 	uint16_t xStart, yStart, xEnd, yEnd; // store coordinates for calculations
 	uint16_t charX;
+	uint16_t scrollFixed, scrollSize; // fixed pixels on the right and size of the scroll area
 
 	void dispWrite(uint8_t sel, uint8_t data); // write data to display
-	void setColor(uint8_t red, uint8_t green, uint8_t blue); // set the drawing color
+	uint8_t dispInit(void); // send the next part of the init sequence, returns the delay in ms before the next part or 0 when done
+	void setColor(uint8_t red, uint8_t green, uint8_t blue); // set the drawing color (6 bit per channel)
+	void setWindow(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2); // open a drawing window (x1 <= x2, y1 <= y2) for pixel data
+	void writeColor(uint32_t count); // stream the drawing color into the opened window
+	void setBackColor(uint8_t red, uint8_t green, uint8_t blue); // set the background color for text
 	void storePosition(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2); // store position into local memory
 	void drawPoint(uint16_t x, uint16_t y); // draw a point on display
+	void drawHLine(uint16_t x, uint16_t y, uint16_t length); // draw a horizontal line on display
+	void drawVLine(uint16_t x, uint16_t y, uint16_t length); // draw a vertical line on display
 	void drawLine(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2); // draw a line on display
 	void drawRect(uint16_t x, uint16_t y, uint16_t sizeX, uint16_t sizeY); // draw a rectangle on display
 	void fillRect(uint16_t x, uint16_t y, uint16_t sizeX, uint16_t sizeY); // fill a rectangle on display
 	void fillRect2(uint16_t x, uint16_t y, uint16_t sizeX, uint16_t sizeY); // fill a rectangle on display (fast)
-	void drawChar(uint16_t x, uint16_t y, char value); // draw a character on display
+	void drawChar(uint16_t x, uint16_t y, char value); // draw a character with background on display, y is the base line
 	void drawString(uint16_t x, uint16_t y, char *value, uint8_t length); // draw a string on display 
+	void setScrollArea(uint16_t left, uint16_t right); // scroll the screen between fixed strips on the left and right
+	void setScrollOffset(uint16_t offset); // move the content of the scroll area to the right by offset pixels
+	void drawTextField(uint16_t x, uint16_t y, uint16_t width, char *value, uint8_t length); // draw a string and clear the rest of the field
+	void drawTextCached(uint16_t x, uint16_t y, uint16_t width, char *value, uint8_t length, textCache *cache); // draw only the characters that differ from the cache
 
 #endif
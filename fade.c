@@ -0,0 +1,88 @@
+// ==================================== [fade.c] =============================
+/*
+*	This library fades the brightness of the light channels between two light
+*	configurations and maps the brightness to gamma corrected duty-cycles.
+*
+*	Author: Tobias Braechter
+*	Last update: 2020-06-21
+*
+*/
+
+#include <avr/pgmspace.h>
+
+#include "fade.h"
+
+// duty-cycle of every percent of brightness, FADE_LEVEL_MAX * (percent / 100) ^ 2.2
+static const uint16_t gamma[FADE_PERCENT_MAX + 1] PROGMEM =
+{
+	0, 0, 1, 2, 3, 6, 8, 12, 16, 20,
+	26, 32, 39, 46, 54, 63, 73, 83, 94, 106,
+	119, 132, 146, 161, 177, 194, 211, 230, 249, 269,
+	290, 311, 334, 357, 382, 407, 433, 460, 487, 516,
+	545, 576, 607, 640, 673, 707, 742, 778, 815, 852,
+	891, 931, 972, 1013, 1056, 1099, 1144, 1189, 1235, 1283,
+	1331, 1380, 1431, 1482, 1534, 1587, 1642, 1697, 1753, 1810,
+	1868, 1928, 1988, 2049, 2111, 2175, 2239, 2304, 2371, 2438,
+	2506, 2576, 2646, 2718, 2790, 2864, 2939, 3014, 3091, 3169,
+	3248, 3328, 3409, 3491, 3574, 3658, 3743, 3830, 3917, 4005,
+	4095
+};
+
+static uint8_t lastLight = FADE_NONE; // light shown or fading in
+static uint8_t lastPreview; // the light shown is a preview
+static uint16_t level[FADE_CHANNELS]; // current brightness in 1/256 percent
+static uint16_t start[FADE_CHANNELS]; // brightness at the start of the fade in 1/256 percent
+static uint8_t target[FADE_CHANNELS]; // brightness at the end of the fade in percent
+static uint16_t time; // seconds of the fade passed
+static uint16_t length; // duration of the fade in seconds
+
+uint8_t fadeSet(uint8_t light, const uint8_t *percent, uint8_t preview, uint16_t fadeLength)
+{
+	// a preview follows every change of the edited option
+	uint8_t changed = preview || light != lastLight;
+	if(changed)
+	{
+		if(preview || lastPreview || lastLight == FADE_NONE)
+			fadeLength = 0;
+		lastLight = light;
+		time = 0;
+		length = fadeLength;
+		for(uint8_t i = 0; i < FADE_CHANNELS; i++)
+		{
+			start[i] = level[i];
+			target[i] = percent[i];
+			if(!length)
+				level[i] = target[i] << 8;
+		}
+	}
+	// kept up to date on every call, the end of a preview without a change of the light
+	// must not suppress the next fade
+	lastPreview = preview;
+	return changed && !length;
+}
+
+uint8_t fadeStep(void)
+{
+	if(time >= length)
+		return 0;
+	time++;
+	for(uint8_t i = 0; i < FADE_CHANNELS; i++)
+		level[i] = start[i] + ((int32_t)(target[i] << 8) - start[i]) * time / length;
+	return 1;
+}
+
+uint16_t fadeLevel(uint8_t channel)
+{
+	return level[channel];
+}
+
+uint16_t fadeDuty(uint8_t channel)
+{
+	// values between two percent are interpolated
+	uint8_t index = level[channel] >> 8;
+	uint16_t low = pgm_read_word(&gamma[index]);
+	if(index >= FADE_PERCENT_MAX)
+		return low;
+	uint16_t high = pgm_read_word(&gamma[index + 1]);
+	return low + (((high - low) * (level[channel] & 0xFF)) >> 8);
+}
@@ -0,0 +1,35 @@
+// ==================================== [fade.h] =============================
+/*
+*	This library fades the brightness of the light channels between two light
+*	configurations and maps the brightness to gamma corrected duty-cycles.
+*
+*	Author: Tobias Braechter
+*	Last update: 2020-06-21
+*
+*/
+
+#ifndef _FADE_H_
+	#define _FADE_H_ 1
+
+	#include <stdint.h>
+
+	#define FADE_CHANNELS 3 // red, green and blue
+	#define FADE_PERCENT_MAX 100 // brightness of a channel is given in percent
+	#define FADE_LEVEL_MAX 4095 // duty-cycles of fadeDuty() have 12 bit
+	#define FADE_NONE 255 // no light shown yet
+
+	// shows the given light with the brightness of each channel in percent. A new light
+	// fades in over length seconds, the first light and every preview are shown at once,
+	// as is the light following a preview. Returns 1 if the brightness changed at once.
+	uint8_t fadeSet(uint8_t light, const uint8_t *percent, uint8_t preview, uint16_t length);
+
+	// advances a running fade by one second, returns 1 if the brightness changed
+	uint8_t fadeStep(void);
+
+	// returns the brightness of the given channel in 1/256 percent
+	uint16_t fadeLevel(uint8_t channel);
+
+	// returns the gamma corrected duty-cycle of the given channel
+	uint16_t fadeDuty(uint8_t channel);
+
+#endif
@@ -0,0 +1,20 @@
+// ==================================== [host/avr/io.h] =============================
+/*
+*	Host replacement for <avr/io.h>, the port registers used by the display driver are
+*	plain variables so display.c can be compiled and run on a PC.
+*
+*	Author: Tobias Braechter
+*	Last update: 2020-06-21
+*
+*/
+
+#ifndef _HOST_AVR_IO_H_
+	#define _HOST_AVR_IO_H_ 1
+
+	#include <stdint.h>
+
+	extern volatile uint8_t PORTA, PORTB, PORTC, PORTD;
+	extern volatile uint8_t DDRA, DDRB, DDRC, DDRD;
+	extern volatile uint8_t PINA, PINB, PINC, PIND;
+
+#endif
@@ -0,0 +1,19 @@
+// ==================================== [host/avr/pgmspace.h] =============================
+/*
+*	Host replacement for <avr/pgmspace.h>, flash tables are ordinary constant data.
+*
+*	Author: Tobias Braechter
+*	Last update: 2020-06-21
+*
+*/
+
+#ifndef _HOST_AVR_PGMSPACE_H_
+	#define _HOST_AVR_PGMSPACE_H_ 1
+
+	#include <stdint.h>
+
+	#define PROGMEM
+	#define pgm_read_byte(address) (*(const uint8_t *)(address))
+	#define pgm_read_word(address) (*(const uint16_t *)(address))
+
+#endif
@@ -0,0 +1,169 @@
+// ====================== [hostMain.c (TerraControl host)] ==========================================
+/*
+*	Runs the display driver against the ILI9341 emulator on a PC. Every drawing primitive
+*	is benchmarked by its bus writes, the resulting screen can be stored as PPM image and
+*	its checksum compared between versions of the driver. The fading of the light and the
+*	edge schedule of the pwm are checked as well, the program fails if they do not behave
+*	as expected.
+*
+*	Usage: terraHost [image.ppm]
+*
+*	Author: Tobias Braechter
+*	Last update: 2020-06-21
+*
+*/
+
+#include <stdio.h>
+
+#include "../display.h"
+#include "../fade.h"
+#include "../pwmEdges.h"
+#include "ili9341Emu.h"
+
+#define DISP_COL_BACK 0,0,0
+#define DISP_COL_FRONT 60,60,60
+#define DISP_COL_OPT 60,30,30
+
+void benchClear(void) { fillRect2(0, 0, 320, 240); }
+void benchGrid(void) { drawLine(0,40,319,40); drawLine(80,40,80,239); drawLine(160,40,160,239); drawLine(240,40,240,239); }
+void benchPoint(void) { drawPoint(300, 20); }
+void benchRect(void) { drawRect(250, 60, 40, 20); }
+void benchDiagonal(void) { drawLine(90, 230, 150, 150); }
+void benchString(void) { drawString(10, 30, "TerraControl", 12); }
+void benchField(void) { setColor(DISP_COL_OPT); drawTextField(100, 130, 48, " 25%", 4); setColor(DISP_COL_FRONT); }
+void benchDegree(void) { drawTextField(95, 220, 58, " 24\xb0" "C", 5); }
+textCache benchCache;
+void benchCacheFill(void) { drawTextCached(260, 100, 36, "109", 3, &benchCache); }
+void benchCacheStep(void) { drawTextCached(260, 100, 36, "110", 3, &benchCache); }
+void benchScroll(void) { setScrollArea(64, 0); setScrollOffset(64); drawVLine(255, 0, 240); }
+void benchNoScroll(void) { setScrollArea(0, 0); }
+
+typedef struct
+{
+	const char *name;
+	void (*run)(void);
+} bench;
+
+bench benches[] =
+{
+	{"fillRect2 320x240", benchClear},
+	{"grid lines", benchGrid},
+	{"drawPoint", benchPoint},
+	{"drawRect 40x20", benchRect},
+	{"drawLine diagonal", benchDiagonal},
+	{"drawString 12 chars", benchString},
+	{"drawTextField 4 chars", benchField},
+	{"drawTextField 5 chars", benchDegree},
+	{"drawTextCached 3 chars", benchCacheFill},
+	{"drawTextCached 2 changed", benchCacheStep},
+	{"scroll and draw column", benchScroll},
+	{"reset scrolling", benchNoScroll},
+};
+
+#define LIGHT_DAY 2
+#define LIGHT_NIGHT 3
+#define FADE_SECONDS 1800
+
+// edits a colour of the current light, leaves the option and crosses into the night,
+// the night has to fade in over the whole duration
+uint8_t checkFade(void)
+{
+	const uint8_t day[3] = {53, 53, 0};
+	const uint8_t edited[3] = {60, 53, 0};
+	const uint8_t night[3] = {42, 30, 0};
+
+	fadeSet(LIGHT_DAY, day, 0, FADE_SECONDS);
+	fadeSet(LIGHT_DAY, edited, 1, FADE_SECONDS);
+	fadeSet(LIGHT_DAY, edited, 1, FADE_SECONDS);
+	if(fadeSet(LIGHT_DAY, edited, 0, FADE_SECONDS) || fadeLevel(0) != (60 << 8))
+		return 0;
+	if(fadeSet(LIGHT_NIGHT, night, 0, FADE_SECONDS))
+		return 0; // switched at once instead of fading
+	uint16_t seconds = 0;
+	while(fadeStep())
+	{
+		seconds++;
+		if(seconds == FADE_SECONDS / 2 && fadeLevel(0) != ((60 + 42) << 7))
+			return 0;
+	}
+	return seconds == FADE_SECONDS && fadeLevel(0) == (42 << 8) && fadeLevel(1) == (30 << 8);
+}
+
+// every step of a duty-cycle has to lengthen the on-time of its channel, whatever the
+// other channels do, and the last segment must leave time to load the next compare
+uint8_t checkEdges(void)
+{
+	const uint8_t masks[PWM_CHANNELS] = {1, 2, 4};
+	const uint16_t others[][2] = {{0, 0}, {2000, 30}, {4095, 1}, {16, 17}, {2048, 4080}};
+	pwmSegment schedule[PWM_SEGMENTS];
+	uint16_t duty[PWM_CHANNELS];
+	for(uint8_t channel = 0; channel < PWM_CHANNELS; channel++)
+	{
+		for(uint8_t set = 0; set < sizeof(others) / sizeof(others[0]); set++)
+		{
+			int32_t lastOn = -1;
+			duty[(channel + 1) % PWM_CHANNELS] = others[set][0];
+			duty[(channel + 2) % PWM_CHANNELS] = others[set][1];
+			for(uint16_t value = 0; value <= FADE_LEVEL_MAX; value++)
+			{
+				duty[channel] = value;
+				uint8_t count = pwmBuild(duty, masks, schedule);
+				uint16_t total = 0;
+				int32_t on = 0;
+				for(uint8_t i = 0; i < count; i++)
+				{
+					total += schedule[i].length;
+					if(schedule[i].mask & masks[channel])
+						on += schedule[i].length;
+				}
+				if(count > PWM_SEGMENTS || total != PWM_PERIOD || schedule[count - 1].length < PWM_MIN_GAP
+					|| on <= lastOn || (value == 0 && on != 0) || (value == FADE_LEVEL_MAX && on != PWM_PERIOD))
+				{
+					printf("edge schedule fails for channel %u at %u\n", channel, value);
+					return 0;
+				}
+				lastOn = on;
+			}
+		}
+	}
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	emuReset();
+	while(dispInit()); // the same init sequence as main(), without waiting
+	setBackColor(DISP_COL_BACK);
+	setColor(DISP_COL_BACK);
+
+	dispStats = (dispStatistics){0};
+	printf("%-24s %10s %10s %10s\n", "primitive", "commands", "data", "pixels");
+	for(uint8_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++)
+	{
+		emuClearCounters();
+		benches[i].run();
+		printf("%-24s %10lu %10lu %10lu\n", benches[i].name, (unsigned long)emuCommands,
+			(unsigned long)emuData, (unsigned long)emuPixels);
+		setColor(DISP_COL_FRONT);
+	}
+	printf("screen checksum %08lx\n", (unsigned long)emuChecksum());
+	printf("driver counters: %lu commands, %lu data, %lu points, %lu lines, %lu fills, %lu chars\n",
+		(unsigned long)dispStats.commands, (unsigned long)dispStats.data, (unsigned long)dispStats.points,
+		(unsigned long)dispStats.lines, (unsigned long)dispStats.fills, (unsigned long)dispStats.chars);
+
+	uint8_t fadeOk = checkFade();
+	printf("fade after editing the current light: %s\n", fadeOk ? "ok" : "FAILED");
+	if(!fadeOk)
+		return 1;
+	uint8_t edgesOk = checkEdges();
+	printf("edge schedule strictly increasing for every duty-cycle: %s\n", edgesOk ? "ok" : "FAILED");
+	if(!edgesOk)
+		return 1;
+
+	if(argc > 1 && !emuSavePpm(argv[1]))
+	{
+		fprintf(stderr, "could not write %s\n", argv[1]);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,281 @@
+// ==================================== [ili9341Emu.c] =============================
+/*
+*	This library emulates the command interface and frame memory of an ILI9341
+*	display controller on a PC.
+*
+*	Author: Tobias Braechter
+*	Last update: 2020-06-21
+*
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ili9341Emu.h"
+
+#define CMD_NONE 0x00
+#define CMD_SWRESET 0x01
+#define CMD_CASET 0x2A
+#define CMD_PASET 0x2B
+#define CMD_RAMWR 0x2C
+#define CMD_VSCRDEF 0x33
+#define CMD_MADCTL 0x36
+#define CMD_VSCRSADD 0x37
+#define CMD_COLMOD 0x3A
+#define CMD_RAMWRC 0x3C
+
+#define MADCTL_MY 0x80
+#define MADCTL_MX 0x40
+#define MADCTL_MV 0x20
+#define MADCTL_BGR 0x08
+
+volatile uint8_t PORTA, PORTB, PORTC, PORTD;
+volatile uint8_t DDRA, DDRB, DDRC, DDRD;
+volatile uint8_t PINA, PINB, PINC, PIND;
+
+static uint8_t memory[EMU_ROWS][EMU_COLUMNS][3]; // frame memory as 8 bit red, green, blue
+
+static uint8_t command; // command the following data belongs to
+static uint8_t param[6]; // parameters of the current command
+static uint8_t paramCount; // received parameters of the current command
+static uint8_t pixel[3]; // bytes of the pixel being received
+static uint8_t pixelCount; // received bytes of the current pixel
+
+static uint16_t startColumn, endColumn, startPage, endPage; // address window
+static uint16_t column, page; // address pointer
+static uint8_t madctl; // memory access control
+static uint8_t colmod; // pixel format
+static uint16_t scrollTop, scrollSize, scrollStart; // vertical scrolling definition and start address
+
+static void resetRegisters(void)
+{
+	command = CMD_NONE;
+	paramCount = 0;
+	pixelCount = 0;
+	startColumn = 0;
+	endColumn = EMU_COLUMNS - 1;
+	startPage = 0;
+	endPage = EMU_ROWS - 1;
+	column = 0;
+	page = 0;
+	madctl = 0x00;
+	colmod = 0x66;
+	scrollTop = 0;
+	scrollSize = EMU_ROWS;
+	scrollStart = 0;
+}
+
+void emuReset(void)
+{
+	memset(memory, 0, sizeof(memory));
+	resetRegisters();
+	emuClearCounters();
+}
+
+void emuClearCounters(void)
+{
+	emuCommands = 0;
+	emuData = 0;
+	emuPixels = 0;
+}
+
+// stores a pixel at the logical address given by column and page
+static void storePixel(uint8_t first, uint8_t second, uint8_t third)
+{
+	uint16_t physColumn = column;
+	uint16_t physRow = page;
+	if(madctl & MADCTL_MV)
+	{
+		physColumn = page;
+		physRow = column;
+	}
+	if(madctl & MADCTL_MX)
+		physColumn = EMU_COLUMNS - 1 - physColumn;
+	if(madctl & MADCTL_MY)
+		physRow = EMU_ROWS - 1 - physRow;
+
+	if(physColumn < EMU_COLUMNS && physRow < EMU_ROWS)
+	{
+		uint8_t *target = memory[physRow][physColumn];
+		if(!(madctl & MADCTL_BGR) != !EMU_PANEL_BGR)
+		{
+			target[0] = third;
+			target[1] = second;
+			target[2] = first;
+		}
+		else
+		{
+			target[0] = first;
+			target[1] = second;
+			target[2] = third;
+		}
+		emuPixels++;
+	}
+
+	// columns are filled first, then the pointer moves to the next page of the window
+	if(column >= endColumn)
+	{
+		column = startColumn;
+		if(page >= endPage)
+			page = startPage;
+		else
+			page++;
+	}
+	else
+		column++;
+}
+
+static void writePixelData(uint8_t data)
+{
+	pixel[pixelCount++] = data;
+	if((colmod & 0x07) == 0x05)
+	{
+		if(pixelCount == 2)
+		{
+			uint8_t first = pixel[0] & 0xF8;
+			uint8_t second = ((pixel[0] << 5) | ((pixel[1] >> 3) & 0x1C));
+			uint8_t third = pixel[1] << 3;
+			storePixel(first | (first >> 5), second | (second >> 6), third | (third >> 5));
+			pixelCount = 0;
+		}
+	}
+	else if(pixelCount == 3)
+	{
+		storePixel(pixel[0] | (pixel[0] >> 6), pixel[1] | (pixel[1] >> 6), pixel[2] | (pixel[2] >> 6));
+		pixelCount = 0;
+	}
+}
+
+static void writeCommand(uint8_t data)
+{
+	command = data;
+	paramCount = 0;
+	pixelCount = 0;
+	switch(command)
+	{
+		case CMD_SWRESET:
+			resetRegisters();
+			break;
+		case CMD_RAMWR:
+			column = startColumn;
+			page = startPage;
+			break;
+	}
+}
+
+static void writeData(uint8_t data)
+{
+	switch(command)
+	{
+		case CMD_RAMWR:
+		case CMD_RAMWRC:
+			writePixelData(data);
+			return;
+		case CMD_CASET:
+		case CMD_PASET:
+			if(paramCount < 4)
+				param[paramCount++] = data;
+			if(paramCount == 4)
+			{
+				uint16_t start = (param[0] << 8) | param[1];
+				uint16_t end = (param[2] << 8) | param[3];
+				if(command == CMD_CASET)
+				{
+					startColumn = start;
+					endColumn = end;
+				}
+				else
+				{
+					startPage = start;
+					endPage = end;
+				}
+			}
+			break;
+		case CMD_VSCRDEF:
+			if(paramCount < 6)
+				param[paramCount++] = data;
+			if(paramCount == 6)
+			{
+				scrollTop = (param[0] << 8) | param[1];
+				scrollSize = (param[2] << 8) | param[3];
+			}
+			break;
+		case CMD_VSCRSADD:
+			if(paramCount < 2)
+				param[paramCount++] = data;
+			if(paramCount == 2)
+				scrollStart = (param[0] << 8) | param[1];
+			break;
+		case CMD_MADCTL:
+			madctl = data;
+			break;
+		case CMD_COLMOD:
+			colmod = data;
+			break;
+	}
+}
+
+void emuWrite(uint8_t sel, uint8_t data)
+{
+	if(sel)
+	{
+		emuData++;
+		writeData(data);
+	}
+	else
+	{
+		emuCommands++;
+		writeCommand(data);
+	}
+}
+
+void emuGetPixel(uint16_t x, uint16_t y, uint8_t *rgb)
+{
+	// the panel is mounted rotated by 90 degrees and mirrored, see setWindow() in display.c
+	uint16_t line = EMU_SCREEN_X - 1 - x;
+	uint16_t row = line;
+	if(line >= scrollTop && line < scrollTop + scrollSize && scrollStart >= scrollTop)
+		row = scrollTop + (line - scrollTop + scrollStart - scrollTop) % scrollSize;
+	uint8_t *source = memory[row][EMU_SCREEN_Y - 1 - y];
+	rgb[0] = source[0];
+	rgb[1] = source[1];
+	rgb[2] = source[2];
+}
+
+uint32_t emuChecksum(void)
+{
+	uint32_t hash = 2166136261UL; // FNV-1a
+	uint8_t rgb[3];
+	for(uint16_t y = 0; y < EMU_SCREEN_Y; y++)
+	{
+		for(uint16_t x = 0; x < EMU_SCREEN_X; x++)
+		{
+			emuGetPixel(x, y, rgb);
+			for(uint8_t i = 0; i < 3; i++)
+			{
+				hash ^= rgb[i];
+				hash *= 16777619UL;
+			}
+		}
+	}
+	return hash;
+}
+
+uint8_t emuSavePpm(const char *fileName)
+{
+	FILE *file = fopen(fileName, "wb");
+	if(!file)
+		return 0;
+
+	uint8_t rgb[3];
+	fprintf(file, "P6\n%d %d\n255\n", EMU_SCREEN_X, EMU_SCREEN_Y);
+	for(uint16_t y = 0; y < EMU_SCREEN_Y; y++)
+	{
+		for(uint16_t x = 0; x < EMU_SCREEN_X; x++)
+		{
+			emuGetPixel(x, y, rgb);
+			fwrite(rgb, 1, 3, file);
+		}
+	}
+	return fclose(file) == 0;
+}
@@ -0,0 +1,36 @@
+// ==================================== [ili9341Emu.h] =============================
+/*
+*	This include file defines a host side emulator of the ILI9341 display controller.
+*	It is fed with every bus write of display.c in host builds (DISP_HOST) and keeps
+*	the frame memory to compare and benchmark the drawing functions on a PC. Vertical
+*	scrolling is applied when the visible screen is read.
+*
+*	Author: Tobias Braechter
+*	Last update: 2020-06-21
+*
+*/
+
+#ifndef _ILI9341_EMU_H_
+	#define _ILI9341_EMU_H_ 1
+
+	#include <stdint.h>
+
+	#define EMU_COLUMNS 240 // physical columns of the frame memory
+	#define EMU_ROWS 320 // physical rows (pages) of the frame memory
+	#define EMU_PANEL_BGR 1 // the module is wired with blue as first color component
+
+	#define EMU_SCREEN_X 320 // size of the screen as mounted in the TerraControl unit
+	#define EMU_SCREEN_Y 240
+
+	uint32_t emuCommands; // number of command writes
+	uint32_t emuData; // number of data writes
+	uint32_t emuPixels; // number of pixels written to the frame memory
+
+	void emuReset(void); // hardware reset: clear frame memory, registers and counters
+	void emuClearCounters(void); // clear the bus counters only
+	void emuWrite(uint8_t sel, uint8_t data); // one bus write, sel is DISP_SEL_COM or DISP_SEL_DAT
+	void emuGetPixel(uint16_t x, uint16_t y, uint8_t *rgb); // screen pixel as 8 bit red, green, blue
+	uint32_t emuChecksum(void); // hash of the visible screen to compare renderings
+	uint8_t emuSavePpm(const char *fileName); // store the visible screen as binary PPM, returns 0 on error
+
+#endif
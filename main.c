@@ -13,10 +13,15 @@
 #include <avr/io.h>
 #include <stdint.h>
 #include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <avr/pgmspace.h>
 
 #include "bitOperation.h"
 #include "terraControl.h"
 #include "display.h"
+#include "scheduler.h"
+#include "fade.h"
+#include "pwmEdges.h"
 
 // ==================================== [pin configuration] ===============================
 
@@ -56,6 +61,14 @@
 // PORTD6 (ICP1)		- Unused
 // PORTD7 (OC2)			- Unused
 
+// With PWM_HARDWARE the LEDs are driven by the timer outputs:
+// PORTD0 (RXD)			- Sensor out
+// PORTD1 (TXD)			- Unused
+// PORTD2 (INT0)		- Unused
+// PORTD4 (OC1B)		- LED Channel Blue
+// PORTD5 (OC1A)		- LED Channel Red
+// PORTD7 (OC2)			- LED Channel Green
+
 #define DDR_HEAT &DDRA,0
 #define HEAT &PORTA,0
 
@@ -66,17 +79,35 @@
 #define ENC_B &PINA,2
 #define ENC_BTN (PINA&(1<<3))
 
+#ifdef PWM_HARDWARE
+#define DDR_LED_RED &DDRD,5
+#define DDR_LED_GRE &DDRD,7
+#define DDR_LED_BLU &DDRD,4
+#define LED_RED &PORTD,5
+#define LED_GRE &PORTD,7
+#define LED_BLU &PORTD,4
+#else
 #define DDR_LED_RED &DDRD,0
 #define DDR_LED_GRE &DDRD,1
 #define DDR_LED_BLU &DDRD,2
 #define LED_RED &PORTD,0
 #define LED_GRE &PORTD,1
 #define LED_BLU &PORTD,2
+#define LED_MASK_RED (1 << 0) // the LED channels as bits of PORTD
+#define LED_MASK_GRE (1 << 1)
+#define LED_MASK_BLU (1 << 2)
+#define LED_MASK (LED_MASK_RED | LED_MASK_GRE | LED_MASK_BLU)
+#endif
 
 #define DDR_SENS_IN &DDRD,3
-#define DDR_SENS_OUT &DDRD,4
 #define SENS_IN (PIND&(1<<3))
+#ifdef PWM_HARDWARE
+#define DDR_SENS_OUT &DDRD,0
+#define SENS_OUT &PORTD,0
+#else
+#define DDR_SENS_OUT &DDRD,4
 #define SENS_OUT &PORTD,4
+#endif
 
 // ==================================== [defines] ==========================================
 
@@ -84,18 +115,47 @@
 #define T_BTN 0
 #define T_ACTION 1
 #define T_WAIT 2
-#define T_CLOCK 3
+#define T_RENDER 3
 
-#define OPTION_PERIOD 100
 #define SAVE_PERIOD 60000
 #define BTN_PERIOD 10
 #define ACTION_PERIOD 10000
 #define CLOCK_PERIOD 900
+#define CALIB_MIN_INTERVAL 86400UL // seconds between two calibrations, corrections are only precise to a minute
+#define CALIB_MAX_CORRECTION 900 // larger changes of the clock are setting the time, not correcting drift
+#define SEC_DAY 86400L
+#define RTC_POLL 100 // the crystal counts the seconds, the clock task only catches up
+#define TICK_STEP 256 // Timer0 overflow period in us, accumulated to the 1 ms tick with CLOCK_RTC
 #define SENS_PERIOD 30000
+#define RENDER_BUDGET 5 // maximum drawing time per main loop iteration in ms
+#define TASK_TOLERANCE (2 * RENDER_BUDGET) // a drawing burst may exceed its budget by one step, later tasks count as missed
+#define DIAG_PERIOD 1000
+
+#define NUM_TASKS 10 // scheduled tasks, ordered by priority
+#define TASK_ENCODER 0
+#define TASK_BUTTON 1
+#define TASK_CLOCK 2
+#define TASK_SENSOR 3
+#define TASK_LIGHT 4
+#define TASK_HEATER 5
+#define TASK_DISPLAY 6
+#define TASK_DIAG 7
+#define TASK_SAVE 8
+#define TASK_FADE 9
+
+#define ENC_POLL 1 // task periods in ms
+#define BTN_POLL 5
+#define LIGHT_POLL 10
+#define HEAT_POLL 1000
+#define DISPLAY_POLL 10
+#define SAVE_POLL 1000
+#define FADE_POLL 1000 // the brightness is interpolated once per second
 
 #define DISP_COL_BACK 0,0,0
 #define DISP_COL_FRONT 60,60,60
 #define DISP_COL_OPT 60,30,30
+#define DISP_COL_TEMP 63,24,12
+#define DISP_COL_HYGRO 16,40,63
 
 #define Y_1 30
 #define Y_2 70
@@ -105,12 +165,69 @@
 #define Y_6 190
 #define Y_7 220
 
-#define SAVED_PATTERN 170
+#define FMT_2DIGIT 0 // two digits with leading zero, for hours and minutes
+#define FMT_NUMBER 1 // three digits, right aligned
+#define FMT_PERCENT 2 // three digits and '%'
+#define FMT_TEMP 3 // three digits and degree celsius
+#define FMT_LIGHT 4 // light mode as text, only for options
+#define FMT_NONE 5 // not drawn
+
+#define WRAP_CLAMP 0 // stop at the limits when editing
+#define WRAP_AROUND 1 // continue at the other limit
+
+#define W_TIME 24 // field widths in pixels
+#define W_NUMBER 36
+#define W_PERCENT 48
+#define W_TEMP 58
+#define W_LIGHT 48
+#define W_DAYTIME 60
+
+#define CLEAR_BANDS 20 // the screen is cleared in bands of 16 pixels
+#define RENDER_SPLASH 0
+#define RENDER_CLEAR 1
+#define RENDER_GRID (RENDER_CLEAR + CLEAR_BANDS)
+#define RENDER_LABELS (RENDER_GRID + 1)
+#define RENDER_DONE (RENDER_LABELS + 1)
+
+#define NUM_DIAG 12 // rows of the diagnostics screen
+#define DIAG_COMMANDS 0
+#define DIAG_DATA 1
+#define DIAG_POINTS 2
+#define DIAG_LINES 3
+#define DIAG_FILLS 4
+#define DIAG_CHARS 5
+#define DIAG_RENDER 6
+#define DIAG_RENDER_MAX 7
+#define DIAG_LATE 8
+#define DIAG_MISSES 9
+#define DIAG_IDLE 10
+#define DIAG_WAKEUPS 11
+#define DIAG_Y(row) (56 + (row) * 16)
+#ifdef DISP_STATS
+#define DIAG_FIRST DIAG_COMMANDS
+#else
+#define DIAG_FIRST DIAG_RENDER // the bus counters are only shown in builds counting them
+#endif
+
+#define LOG_WIDTH 64 // width of a log entry and of the fixed label strip
+#define LOG_Y_TIME Y_2
+#define LOG_Y_TEMP Y_4
+#define LOG_Y_HYGRO Y_6
+
+#define GRAPH_WIDTH 32 // width of the fixed label strip, the rest holds one column per sample
+#define GRAPH_TOP 39 // row of 50 degree celsius and 100 percent
+#define GRAPH_BOTTOM 239 // row of zero
+#define GRAPH_SCALE_TEMP 4 // pixels per degree celsius
+#define GRAPH_SCALE_HYGRO 2 // pixels per percent
+
+#define SAVED_PATTERN 172
+#define SAVED_FRACTION (NUM_OPT + 1) // EEPROM address of the clock fraction, after the options
+
+#define POWER_UP 20 // wait for the supply of the display in ms
 
 #define SENS_TIMEOUT 65000
 #define SENS_MAX_ERR 1
 
-#define SENS_NOT_READ 0
 #define SENS_OK 1
 
 #define LIGHT_OFF 0
@@ -123,42 +240,184 @@
 #define COL_GRE 1
 #define COL_BLU 2
 
+#if defined(PWM_HARDWARE) && defined(CLOCK_RTC)
+#error "PWM_HARDWARE needs Timer2 for the green channel, it can not run from the crystal"
+#endif
+#if defined(PWM_HARDWARE) && defined(PWM_EDGES)
+#error "select only one of PWM_HARDWARE and PWM_EDGES"
+#endif
+
+#ifdef PWM_HARDWARE
+#define PWM_TOP 7999 // top of Timer1, 1 kHz at 8 MHz, the overflow is the 1 ms tick
+#endif
+
 // ==================================== [variables] ==========================================
 
-volatile uint16_t timer; // counter for main-time
-uint16_t timers[NUM_TIMERS]; // counters for different actions
+typedef struct
+{
+	uint16_t x; // position and width of the field
+	uint8_t y;
+	uint8_t width;
+	uint8_t format; // FMT_*
+	uint8_t min; // range and step when editing with the encoder
+	uint8_t max;
+	uint8_t step;
+	uint8_t wrap; // WRAP_*
+	uint8_t preset; // default value
+} optionDescriptor;
+
+static const optionDescriptor optionTable[NUM_OPT] PROGMEM =
+{
+	{0, 0, 0, FMT_NONE, 0, MAX_NONE, 1, WRAP_AROUND, MAX_NONE}, // OPT_NONE
+	{250, Y_6, W_LIGHT, FMT_LIGHT, 0, MAX_LIGHT, 1, WRAP_AROUND, OPT_LIGHT_AUTO}, // OPT_LIGHT
+	{90, Y_3, W_TIME, FMT_2DIGIT, 0, MAX_HOUR, 1, WRAP_AROUND, 8}, // OPT_DAY_HOUR
+	{120, Y_3, W_TIME, FMT_2DIGIT, 0, MAX_MIN, 1, WRAP_AROUND, 0}, // OPT_DAY_MIN
+	{100, Y_4, W_PERCENT, FMT_PERCENT, 0, MAX_PWM, 1, WRAP_CLAMP, 53}, // OPT_DAY_RED
+	{100, Y_5, W_PERCENT, FMT_PERCENT, 0, MAX_PWM, 1, WRAP_CLAMP, 53}, // OPT_DAY_GRE
+	{100, Y_6, W_PERCENT, FMT_PERCENT, 0, MAX_PWM, 1, WRAP_CLAMP, 0}, // OPT_DAY_BLU
+	{95, Y_7, W_TEMP, FMT_TEMP, 0, MAX_TEMP, 1, WRAP_CLAMP, 0}, // OPT_DAY_TEMP
+	{170, Y_3, W_TIME, FMT_2DIGIT, 0, MAX_HOUR, 1, WRAP_AROUND, 22}, // OPT_NIGHT_HOUR
+	{200, Y_3, W_TIME, FMT_2DIGIT, 0, MAX_MIN, 1, WRAP_AROUND, 0}, // OPT_NIGHT_MIN
+	{180, Y_4, W_PERCENT, FMT_PERCENT, 0, MAX_PWM, 1, WRAP_CLAMP, 42}, // OPT_NIGHT_RED
+	{180, Y_5, W_PERCENT, FMT_PERCENT, 0, MAX_PWM, 1, WRAP_CLAMP, 30}, // OPT_NIGHT_GRE
+	{180, Y_6, W_PERCENT, FMT_PERCENT, 0, MAX_PWM, 1, WRAP_CLAMP, 0}, // OPT_NIGHT_BLU
+	{175, Y_7, W_TEMP, FMT_TEMP, 0, MAX_TEMP, 1, WRAP_CLAMP, 0}, // OPT_NIGHT_TEMP
+	{250, Y_3, W_TIME, FMT_2DIGIT, 0, MAX_HOUR, 1, WRAP_AROUND, 0}, // OPT_HOUR
+	{280, Y_3, W_TIME, FMT_2DIGIT, 0, MAX_MIN, 1, WRAP_AROUND, 0}, // OPT_MIN
+	{260, Y_4, W_NUMBER, FMT_NUMBER, 0, MAX_CLOCK, 1, WRAP_CLAMP, 92}, // OPT_CLOCK
+	{6, Y_2, W_NUMBER, FMT_NUMBER, 0, MAX_RAMP, 5, WRAP_CLAMP, 30} // OPT_RAMP
+};
+
+volatile uint32_t timer; // counter for main-time in ms, wraps after 49 days
+uint32_t timers[NUM_TIMERS]; // counters for different actions
 uint16_t clockCycle; // stores the clock cycle for one second
-volatile uint8_t pwmCycle; // counter for pwm-cycle
+uint8_t clockFraction; // 1/256 ms added to the clock cycle, stored behind the options
 uint8_t seconds; // stores the current seconds
+#ifndef CLOCK_RTC
+uint8_t clockAccu; // accumulated fraction, a carry lengthens the second by 1 ms
+uint8_t calibValid; // a reference correction has been made
+uint8_t calibEditing; // the user is correcting the clock
+uint32_t calibSeconds; // seconds counted since the reference correction
+int32_t calibCorrection; // seconds the user corrected since the reference
+uint32_t calibStart; // time of day before the current correction
+uint32_t calibStartSeconds; // calibSeconds at the start of the current correction
+#endif
+#ifdef CLOCK_RTC
+volatile uint8_t rtcCount; // seconds counted by the crystal, wraps
+uint8_t rtcSeen; // seconds already added to the clock
+uint16_t tickFraction; // microseconds of Timer0 overflows not yet added to the tick
+#endif
 
 volatile uint8_t optionsChanged; // stores if options have been changed
 uint8_t buttonStateOld; // stores the last state of the button
 uint8_t encStateOld; // stores the last state of the encoder
-uint8_t lastLight; // stores the last state of light
+uint8_t lightMode; // OPT_LIGHT of the last light configuration
 uint8_t sensError; // counts the times the sensor could not be read
-uint8_t duty[NUM_COL]; // stores the current duty-cycles for RGB
+uint16_t duty[NUM_COL]; // stores the current duty-cycles for RGB, 0 to FADE_LEVEL_MAX
+#ifdef PWM_EDGES
+pwmSegment pwmSchedule[2][PWM_SEGMENTS] = {{{0, PWM_PERIOD}}, {{0, PWM_PERIOD}}}; // segments of one period, the interrupt plays one buffer while the other is written
+volatile uint8_t pwmCount[2] = {1, 1}; // used segments of each buffer
+volatile uint8_t pwmActive; // buffer played by the interrupt
+volatile uint8_t pwmPending; // the other buffer is ready, taken over at the end of the period
+uint8_t pwmIndex; // segment played by the interrupt
+#elif !defined(PWM_HARDWARE)
+volatile uint8_t pwmCycle; // counter for pwm-cycle
+volatile uint8_t pwmNext[NUM_COL]; // duty-cycles written by pwmUpdate()
+volatile uint8_t pwmPending; // pwmNext is ready, taken over at the start of the period
+uint8_t pwmDuty[NUM_COL]; // duty-cycles of the current period
+#endif
 
 char buffer[10]; // buffer for drawing strings
+textCache optionText[NUM_OPT]; // text of each option field as drawn
+textCache dataText[NUM_DAT]; // text of each data field as drawn
+
+uint32_t renderOptions; // options waiting to be drawn
+uint8_t renderData; // data waiting to be drawn
+uint8_t renderStep = RENDER_DONE; // next step of drawing the static screen
+uint8_t renderIndex; // field to continue drawing with
+uint16_t renderDiag; // rows of the diagnostics screen waiting to be drawn
+uint8_t renderLog; // log entries waiting to be scrolled in
+uint16_t renderGraph; // history samples waiting to be scrolled in
+
+uint8_t logHead; // next entry of the sensor log to write
+uint8_t logCount; // valid entries of the sensor log
+uint16_t logScroll; // current scroll offset of the log screen
+
+uint16_t histHead; // next sample of the history to write
+uint16_t histCount; // valid samples of the history
+uint16_t graphScroll; // current scroll offset of the graph screen
+
+uint16_t renderTime; // duration of the last drawing burst in ms
+uint16_t renderTimeMax; // longest drawing burst in ms
+
+uint16_t idleTicks; // ticks the main loop slept through since the last diagnostics update
+uint16_t idleWakeups; // interrupts waking the main loop since the last diagnostics update
+uint8_t idleRatio; // share of the ticks in the last second the cpu slept in at all in %
+uint16_t wakeupRate; // wakeups in the last second
 
 // ==================================== [function declaration] ==========================================
 
 void initialize(void); // setting the timers, uart, etc.
-void drawInitScreen(void); // draw the main screen
+void drawInitScreen(void); // queue the main screen for drawing
+void drawInitStep(uint8_t step); // draw one step of the static screen
+uint8_t renderNext(void); // draw the next pending part of the screen
 void drawOption(uint8_t index); // draw the given option
 void drawData(uint8_t index); // draw the given data
-char getNumber(uint8_t value, uint8_t pos, char fill); // get specific number
+void drawDiag(uint8_t row); // draw a row of the diagnostics screen
+void drawLogEntry(logEntry *entry); // scroll in a new entry on the log screen
+void logSensor(void); // add the current sensor data to the log
+void drawGraphSample(uint16_t index, uint8_t connect); // scroll in a new column on the graph screen
+void drawGraphSegment(uint16_t x, uint8_t value, uint8_t prev, uint8_t scale); // plot one value of a column
+void histSample(void); // add the current sensor data to the history
+uint8_t formatValue(char *dest, uint8_t value, uint8_t format); // format a value as given by FMT_*, returns the length
+uint8_t formatTime(char *dest, uint8_t hour, uint8_t min); // format a time as HH:MM, returns the length
+void formatLong(char *dest, uint32_t value, uint8_t length); // right aligned decimal number
 void loadOptions(void); // load stored options
 void loadDefaultOptions(void); // load a default set of options
 void saveOptions(void); // store current options
 void handleTime(void); // calculate the current time
+void nextSecond(void); // advance the clock by one second
+uint32_t getTimeOfDay(void); // seconds since midnight
+void noteClockEdit(void); // remember the clock before the user corrects it
+void handleCalibration(void); // adjust the clock cycle when a correction is finished
+int32_t divRound(int32_t value, int32_t divisor); // signed division rounded to the nearest integer
 void handleButton(void); // check if the encoder button was clicked
 void handleEncoder(void); // check if the encoder got rotated
+void changeOption(uint8_t index, int8_t direction); // step an option up or down within its limits
 void handleLight(void); // determine the current light configuration
+void handleFade(void); // move the brightness towards the light configuration
+void lightOutput(void); // pass the brightness to the pwm
+void pwmUpdate(void); // pass changed duty-cycles to the pwm
 uint8_t handleSensor(void); // read sensor data
 void handleHeater(void); // control the heater
-void handleDisplay(void); // draw the display screen
+void handleDisplay(void); // find the parts of the screen that have to be drawn
+void handleDiag(void); // refresh the diagnostics screen
+uint8_t renderDisplay(void); // draw pending parts of the screen within the time budget, returns 0 if nothing was drawn
+void idleSleep(uint32_t now); // sleep until the main-time has passed now
+void handleSensorTask(void); // read the sensor and keep track of errors
+uint32_t getTicks(void); // get the main-time without disabling interrupts
 void resetTimer(uint8_t index); // reset the given timer
-uint16_t getTimeDiff(uint8_t index); // get the counter value of the given timer
+uint32_t getTimeDiff(uint8_t index); // get the counter value of the given timer
+
+// ==================================== [tasks] ==========================================
+
+schedTask tasks[NUM_TASKS] =
+{
+	{handleEncoder, ENC_POLL},
+	{handleButton, BTN_POLL},
+#ifdef CLOCK_RTC
+	{handleTime, RTC_POLL},
+#else
+	{handleTime, CLOCK_PERIOD},
+#endif
+	{handleSensorTask, SENS_PERIOD},
+	{handleLight, LIGHT_POLL},
+	{handleHeater, HEAT_POLL},
+	{handleDisplay, DISPLAY_POLL},
+	{handleDiag, DIAG_PERIOD},
+	{saveOptions, SAVE_POLL},
+	{handleFade, FADE_POLL}
+};
 
 // ==================================== [program start] ==========================================
 
@@ -166,43 +425,31 @@ int main(void)
 {
 	initialize();
 	resetTimer(T_WAIT);
-	while(getTimeDiff(T_WAIT)<100);
-
-	loadOptions();
+	while(getTimeDiff(T_WAIT) < POWER_UP);
 
 	DDR_DISP_DATA = ~0;
-	dispWrite(DISP_SEL_COM, 0x11);
+	uint8_t delay = dispInit(); // software reset
+	if(!readBit(&MCUCSR, PORF))
+		delay = DISP_RESET_WARM; // the display kept its power and may be awake
+	MCUCSR = 0;
 	resetTimer(T_WAIT);
-	while(getTimeDiff(T_WAIT) < 5);
-	dispWrite(DISP_SEL_COM, 0x29);
+	while(getTimeDiff(T_WAIT) < delay);
+	delay = dispInit(); // setup and sleep out
 	resetTimer(T_WAIT);
-	while(getTimeDiff(T_WAIT)<100);
+	loadOptions(); // done while the display wakes up
 	drawInitScreen();
+	while(getTimeDiff(T_WAIT) < delay);
 
+	// the tasks run when they are due, the time in between is used for drawing
+	// the scheduler uses the lower 16 bit of the main-time, all periods are below 65 s
+	// without any work left the cpu sleeps until the next tick, the timers keep running
+	schedStart(tasks, NUM_TASKS, getTicks());
+	set_sleep_mode(SLEEP_MODE_IDLE);
 	while(1)
 	{
-		saveOptions();
-		handleTime();
-		handleButton();
-		handleEncoder();
-		handleLight();
-		uint8_t retVal = handleSensor();
-		setBit(&TIMSK, OCIE1A, 1); // enable output compare match interrupt
-		if(retVal == SENS_OK)
-			sensError = 0;
-		else if(retVal != SENS_NOT_READ)
-		{
-			sensError++;
-			if(sensError > SENS_MAX_ERR)
-			{
-				data[DAT_HYGRO_OK] = 0;
-				data[DAT_TEMP_OK] = 0;
-			}
-		}
-		handleHeater();
-		handleDisplay();
-		if(getTimeDiff(T_ACTION) > ACTION_PERIOD)
-			data[DAT_OPTION] = OPT_NONE;
+		uint32_t now = getTicks();
+		if(!schedRun(tasks, NUM_TASKS, now, TASK_TOLERANCE) && !renderDisplay())
+			idleSleep(now);
 	}
 }
 
@@ -211,24 +458,6 @@ void initialize(void)
 	cli(); // disable global interrupts
 
 	data[DAT_OPTION] = OPT_NONE;
-
-	optionMax[OPT_NONE] = MAX_NONE;
-	optionMax[OPT_LIGHT] = MAX_LIGHT;
-	optionMax[OPT_DAY_HOUR] = MAX_HOUR;
-	optionMax[OPT_DAY_MIN] = MAX_MIN;
-	optionMax[OPT_DAY_RED] = MAX_PWM;
-	optionMax[OPT_DAY_GRE] = MAX_PWM;
-	optionMax[OPT_DAY_BLU] = MAX_PWM;
-	optionMax[OPT_DAY_TEMP] = MAX_TEMP;
-	optionMax[OPT_NIGHT_HOUR] = MAX_HOUR;
-	optionMax[OPT_NIGHT_MIN] = MAX_MIN;
-	optionMax[OPT_NIGHT_RED] = MAX_PWM;
-	optionMax[OPT_NIGHT_GRE] = MAX_PWM;
-	optionMax[OPT_NIGHT_BLU] = MAX_PWM;
-	optionMax[OPT_NIGHT_TEMP] = MAX_TEMP;
-	optionMax[OPT_HOUR] = MAX_HOUR;
-	optionMax[OPT_MIN] = MAX_MIN;
-	optionMax[OPT_CLOCK] = MAX_CLOCK;
   
 	// LED output configuration
 	setBit(DDR_LED_RED, 1); // set pin for red channel as output
@@ -267,8 +496,35 @@ void initialize(void)
 	setBit(&TCCR0, CS01, 1);
 	setBit(&TCCR0, CS00, 0);
 
+#ifdef PWM_HARDWARE
+	// pwm timer setup, the red and blue channel on OC1A and OC1B, the outputs are
+	// connected by pwmUpdate()
+	ICR1 = PWM_TOP;
+	setBit(&TCCR1B, WGM13, 1); // fast pwm mode with ICR1 as top
+	setBit(&TCCR1B, WGM12, 1);
+	setBit(&TCCR1A, WGM11, 1);
+	setBit(&TCCR1A, WGM10, 0);
+	setBit(&TCCR1B, CS12, 0); // no divider -> 8 MHz
+	setBit(&TCCR1B, CS11, 0);
+	setBit(&TCCR1B, CS10, 1);
+
+	// main timer setup, the overflow of the pwm timer is the 1 ms tick
+	setBit(&TIMSK, TOIE1, 1); // enable overflow interrupt
+
+	// pwm timer setup, the green channel on OC2
+	setBit(&TCCR2, WGM21, 1); // fast pwm mode
+	setBit(&TCCR2, WGM20, 1);
+	setBit(&TCCR2, CS22, 0);
+	setBit(&TCCR2, CS21, 1);
+	setBit(&TCCR2, CS20, 1); // divider 32 -> 977 Hz
+	pwmUpdate();
+#else
 	// pwm timer setup
+#ifdef PWM_EDGES
+	OCR1A = PWM_PERIOD - 1; // the interrupt loads the length of the next segment
+#else
 	OCR1A = 100; // pwm interrupt frequency 10 kHz
+#endif
 	setBit(&TCCR1B, WGM13, 0); // ctc mode
 	setBit(&TCCR1B, WGM12, 1);
 	setBit(&TCCR1A, WGM11, 0);
@@ -277,7 +533,21 @@ void initialize(void)
 	setBit(&TCCR1B, CS12, 0); // divider 8 -> 1 MHz
 	setBit(&TCCR1B, CS11, 1);
 	setBit(&TCCR1B, CS10, 0);
-
+#endif
+
+#ifdef CLOCK_RTC
+	// main timer setup, the 1 ms tick is accumulated from the sensor timer overflows
+	setBit(&TIMSK, TOIE0, 1); // enable overflow interrupt
+
+	// real time clock setup, Timer2 runs from the 32.768 kHz crystal on TOSC1/TOSC2
+	setBit(&TIMSK, TOIE2, 0);
+	setBit(&ASSR, AS2, 1); // asynchronous mode
+	TCNT2 = 0;
+	TCCR2 = (1 << CS22) | (1 << CS20); // normal mode, divider 128 -> overflow every second
+	while(ASSR & ((1 << TCN2UB) | (1 << TCR2UB))); // wait until the registers are taken over
+	TIFR = (1 << TOV2); // clear a flag from switching the clock source
+	setBit(&TIMSK, TOIE2, 1); // enable overflow interrupt
+#elif !defined(PWM_HARDWARE)
 	// main timer setup
 	OCR2 = 125; // time-base 1 ms
 	setBit(&TCCR2, WGM21, 1); // ctc mode
@@ -286,212 +556,467 @@ void initialize(void)
 	setBit(&TCCR2, CS22, 1);
 	setBit(&TCCR2, CS21, 0);
 	setBit(&TCCR2, CS20, 0); // divider 64 -> 1/8 MHz
+#endif
 
 	sei(); // enable global interrupts
 }
 
 void drawInitScreen(void)
 {
-	setColor(DISP_COL_FRONT);
-	drawLine(0, 40, 319, 40);
-	drawLine(0, 200, 319, 200);
-	drawString(110, 130, "TerraControl", 12);
-	setColor(DISP_COL_BACK);
-	fillRect2(0, 0, 320, 240);
-
-	setColor(DISP_COL_FRONT);
-	drawLine(0,40,319,40);
-	drawLine(80,40,80,239);
-	drawLine(160,40,160,239);
-	drawLine(240,40,240,239);
-
-	drawString(10, Y_1, "TerraControl", 12);
-	drawString(200, Y_1, "Luftf.", 6);
-	drawString(20, Y_3, "Uhr", 3);
-	drawString(30, Y_4, "R", 1);
-	drawString(30, Y_5, "G", 1);
-	drawString(30, Y_6, "B", 1);
-	drawString(10, Y_7, "Temp", 4);
-	drawString(90,Y_2,"Tag",3);
-	drawChar(116,Y_3,':');
-	drawString(170,Y_2,"Nacht",5);
-	drawChar(196,Y_3,':');
-	drawChar(276,Y_3,':');
-	drawChar(250,Y_4,'T');
-	drawString(250, Y_5, "Licht", 5);
+	renderStep = RENDER_SPLASH;
+	renderOptions = (1UL << NUM_OPT) - 1;
+	renderData = (1 << NUM_DAT) - 1;
+}
 
-	for(uint8_t i = 0; i < NUM_OPT; i++)
-		drawOption(i);
+void drawInitStep(uint8_t step)
+{
+	setBackColor(DISP_COL_BACK);
+	if(step == RENDER_SPLASH)
+	{
+		// the frame memory holds random data after power-up, it is cleared before the display is turned on
+		setColor(DISP_COL_BACK);
+		fillRect2(0, 0, DISP_MAX_X + 1, DISP_MAX_Y + 1);
+		dispInit(); // display on
+		setColor(DISP_COL_FRONT);
+		drawLine(0, 40, 319, 40);
+		drawLine(0, 200, 319, 200);
+		drawString(110, 130, "TerraControl", 12);
+	}
+	else if(step < RENDER_GRID)
+	{
+		setColor(DISP_COL_BACK);
+		fillRect2((step - RENDER_CLEAR) * 16, 0, 16, 240);
+	}
+	else if(data[DAT_SCREEN] == SCREEN_LOG)
+	{
+		setColor(DISP_COL_FRONT);
+		if(step == RENDER_GRID)
+			drawLine(LOG_WIDTH-1,0,LOG_WIDTH-1,239);
+		else if(step == RENDER_LABELS)
+		{
+			drawString(4, Y_1, "Log", 3);
+			drawString(4, LOG_Y_TIME, "Zeit", 4);
+			drawString(4, LOG_Y_TEMP, "Temp", 4);
+			drawString(4, LOG_Y_HYGRO, "Luft", 4);
+		}
+	}
+	else if(data[DAT_SCREEN] == SCREEN_GRAPH)
+	{
+		setColor(DISP_COL_FRONT);
+		if(step == RENDER_GRID)
+		{
+			drawLine(GRAPH_WIDTH-1,0,GRAPH_WIDTH-1,239);
+			drawLine(GRAPH_WIDTH-6,GRAPH_TOP,GRAPH_WIDTH-2,GRAPH_TOP);
+			drawLine(GRAPH_WIDTH-6,(GRAPH_TOP+GRAPH_BOTTOM)/2,GRAPH_WIDTH-2,(GRAPH_TOP+GRAPH_BOTTOM)/2);
+			drawLine(GRAPH_WIDTH-6,GRAPH_BOTTOM,GRAPH_WIDTH-2,GRAPH_BOTTOM);
+		}
+		else if(step == RENDER_LABELS)
+		{
+			// the scale is given in degree celsius, the humidity is plotted at twice the range
+			drawString(0, GRAPH_TOP + 6, "50", 2);
+			drawString(0, (GRAPH_TOP+GRAPH_BOTTOM)/2 + 6, "25", 2);
+			drawString(0, GRAPH_BOTTOM - 3, "0", 1);
+			setColor(DISP_COL_TEMP);
+			drawChar(0, 17, 'T');
+			setColor(DISP_COL_HYGRO);
+			drawChar(14, 17, '%');
+		}
+	}
+	else if(data[DAT_SCREEN] == SCREEN_DIAG)
+	{
+		setColor(DISP_COL_FRONT);
+		if(step == RENDER_GRID)
+			drawLine(0,40,319,40);
+		else if(step == RENDER_LABELS)
+		{
+			drawString(10, Y_1, "Diagnose", 8);
+#ifdef DISP_STATS
+			drawString(10, DIAG_Y(DIAG_COMMANDS), "Befehle", 7);
+			drawString(10, DIAG_Y(DIAG_DATA), "Daten", 5);
+			drawString(10, DIAG_Y(DIAG_POINTS), "Punkte", 6);
+			drawString(10, DIAG_Y(DIAG_LINES), "Linien", 6);
+			drawString(10, DIAG_Y(DIAG_FILLS), "Flaechen", 8);
+			drawString(10, DIAG_Y(DIAG_CHARS), "Zeichen", 7);
+#endif
+			drawString(10, DIAG_Y(DIAG_RENDER), "Zeichnen ms", 11);
+			drawString(10, DIAG_Y(DIAG_RENDER_MAX), "Maximum ms", 10);
+			drawString(10, DIAG_Y(DIAG_LATE), "Verzug ms", 9);
+			drawString(10, DIAG_Y(DIAG_MISSES), "Verpasst", 8);
+			drawString(10, DIAG_Y(DIAG_IDLE), "Ticks Schlaf %", 14);
+			drawString(10, DIAG_Y(DIAG_WAKEUPS), "Wecken /s", 9);
+		}
+	}
+	else if(step == RENDER_GRID)
+	{
+		setColor(DISP_COL_FRONT);
+		drawLine(0,40,319,40);
+		drawLine(80,40,80,239);
+		drawLine(160,40,160,239);
+		drawLine(240,40,240,239);
+	}
+	else if(step == RENDER_LABELS)
+	{
+		setColor(DISP_COL_FRONT);
+		drawString(10, Y_1, "TerraControl", 12);
+		drawString(190, Y_1, "Luftf.", 6);
+		drawString(44, Y_2, "min", 3);
+		drawString(20, Y_3, "Uhr", 3);
+		drawString(30, Y_4, "R", 1);
+		drawString(30, Y_5, "G", 1);
+		drawString(30, Y_6, "B", 1);
+		drawString(10, Y_7, "Temp", 4);
+		drawString(90,Y_2,"Tag",3);
+		drawChar(114,Y_3,':');
+		drawString(170,Y_2,"Nacht",5);
+		drawChar(194,Y_3,':');
+		drawChar(274,Y_3,':');
+		drawChar(246,Y_4,'T');
+		drawString(250, Y_5, "Licht", 5);
+	}
+}
 
-	for(uint8_t i = 0; i < NUM_DAT; i++)
-		drawData(i);
+uint8_t renderNext(void)
+{
+	if(renderStep < RENDER_DONE)
+	{
+		drawInitStep(renderStep++);
+		return 1;
+	}
+
+	if(data[DAT_SCREEN] == SCREEN_LOG)
+	{
+		if(renderLog)
+		{
+			setColor(DISP_COL_FRONT);
+			drawLogEntry(&sensorLog[(logHead + LOG_SIZE - renderLog) % LOG_SIZE]);
+			renderLog--;
+			return 1;
+		}
+		return 0;
+	}
+
+	if(data[DAT_SCREEN] == SCREEN_GRAPH)
+	{
+		if(renderGraph)
+		{
+			// only the first sample of a redraw has no drawn predecessor to connect to
+			drawGraphSample((histHead + HIST_SIZE - renderGraph) % HIST_SIZE, renderGraph < histCount);
+			renderGraph--;
+			return 1;
+		}
+		return 0;
+	}
+
+	if(data[DAT_SCREEN] == SCREEN_DIAG)
+	{
+		for(uint8_t row = DIAG_FIRST; row < NUM_DIAG; row++)
+		{
+			if(renderDiag & (1U << row))
+			{
+				renderDiag &= ~(1U << row);
+				setColor(DISP_COL_FRONT);
+				drawDiag(row);
+				return 1;
+			}
+		}
+		return 0;
+	}
+
+	// continue with the field after the last drawn one, so no field starves
+	for(uint8_t n = 0; n < NUM_OPT + NUM_DAT; n++)
+	{
+		uint8_t index = renderIndex;
+		if(++renderIndex == NUM_OPT + NUM_DAT)
+			renderIndex = 0;
+
+		if(index < NUM_OPT)
+		{
+			if(renderOptions & (1UL << index))
+			{
+				renderOptions &= ~(1UL << index);
+				if(index == data[DAT_OPTION])
+					setColor(DISP_COL_OPT);
+				else
+					setColor(DISP_COL_FRONT);
+				drawOption(index);
+				return 1;
+			}
+		}
+		else
+		{
+			index -= NUM_OPT;
+			if(renderData & (1 << index))
+			{
+				renderData &= ~(1 << index);
+				setColor(DISP_COL_FRONT);
+				drawData(index);
+				return 1;
+			}
+		}
+	}
+	return 0;
 }
 
 void drawOption(uint8_t index)
+{
+	optionDescriptor desc;
+	memcpy_P(&desc, &optionTable[index], sizeof(desc));
+	if(desc.format == FMT_NONE)
+		return;
+	if(desc.format == FMT_LIGHT)
+	{
+		if(options[index] == OPT_LIGHT_AUTO)
+			drawTextCached(desc.x, desc.y, desc.width, "Auto", 4, &optionText[index]);
+		else if(options[index] == OPT_LIGHT_ON)
+			drawTextCached(desc.x, desc.y, desc.width, "On", 2, &optionText[index]);
+		else
+			drawTextCached(desc.x, desc.y, desc.width, "Off", 3, &optionText[index]);
+	}
+	else
+		drawTextCached(desc.x, desc.y, desc.width, buffer, formatValue(buffer, options[index], desc.format), &optionText[index]);
+}
+
+void drawData(uint8_t index)
 {
 	switch(index)
 	{
-		case OPT_LIGHT:
-			if(options[index] == OPT_LIGHT_AUTO)
-				drawString(250,Y_6,"Auto",4);
-			else if(options[index] == OPT_LIGHT_ON)
-				drawString(250,Y_6,"On",2);
+		case DAT_TEMP:
+		case DAT_TEMP_OK:
+			if(data[DAT_TEMP_OK])
+				drawTextCached(255, Y_7, W_TEMP, buffer, formatValue(buffer, data[DAT_TEMP], FMT_TEMP), &dataText[DAT_TEMP]);
 			else
-				drawString(250,Y_6,"Off",3);
-			break;
-		case OPT_DAY_HOUR:
-			buffer[0] = getNumber(options[OPT_DAY_HOUR],1,'0');
-			buffer[1] = getNumber(options[OPT_DAY_HOUR],0,'0');
-			drawString(90,Y_3,buffer,2);
+				drawTextCached(255, Y_7, W_TEMP, " --C", 5, &dataText[DAT_TEMP]);
 			break;
-		case OPT_DAY_MIN:
-			buffer[0] = getNumber(options[OPT_DAY_MIN],1,'0');
-			buffer[1] = getNumber(options[OPT_DAY_MIN],0,'0');
-			drawString(120,Y_3,buffer,2);
+		case DAT_HYGRO:
+		case DAT_HYGRO_OK:
+			if(data[DAT_HYGRO_OK])
+				drawTextCached(260, Y_1, W_PERCENT, buffer, formatValue(buffer, data[DAT_HYGRO], FMT_PERCENT), &dataText[DAT_HYGRO]);
+			else
+				drawTextCached(260, Y_1, W_PERCENT, " --%", 4, &dataText[DAT_HYGRO]);
 			break;
-		case OPT_DAY_RED:
-			buffer[0] = getNumber(options[index],2,' ');
-			buffer[1] = getNumber(options[index],1,' ');
-			buffer[2] = getNumber(options[index],0,'0');
-			buffer[3] = '%';
-			drawString(100,Y_4,buffer,4);
+		case DAT_DAYTIME:
+			if(data[DAT_DAYTIME] == DAYTIME_DAY)
+				drawTextCached(250, Y_2, W_DAYTIME, "Tag", 3, &dataText[DAT_DAYTIME]);
+			else
+				drawTextCached(250, Y_2, W_DAYTIME, "Nacht", 5, &dataText[DAT_DAYTIME]);
 			break;
-		case OPT_DAY_GRE:
-			buffer[0] = getNumber(options[index],2,' ');
-			buffer[1] = getNumber(options[index],1,' ');
-			buffer[2] = getNumber(options[index],0,'0');
-			buffer[3] = '%';
-			drawString(100,Y_5,buffer,4);
+	}
+}
+
+void drawDiag(uint8_t row)
+{
+	uint32_t value = 0;
+	switch(row)
+	{
+#ifdef DISP_STATS
+		case DIAG_COMMANDS:
+			value = dispStats.commands;
 			break;
-		case OPT_DAY_BLU:
-			buffer[0] = getNumber(options[index],2,' ');
-			buffer[1] = getNumber(options[index],1,' ');
-			buffer[2] = getNumber(options[index],0,'0');
-			buffer[3] = '%';
-			drawString(100,Y_6,buffer,4);
+		case DIAG_DATA:
+			value = dispStats.data;
 			break;
-		case OPT_DAY_TEMP:
-			buffer[0] = getNumber(options[index],2,' ');
-			buffer[1] = getNumber(options[index],1,' ');
-			buffer[2] = getNumber(options[index],0,'0');
-			buffer[3] = '';
-			buffer[4] = 'C';
-			drawString(95,Y_7,buffer,5);
+		case DIAG_POINTS:
+			value = dispStats.points;
 			break;
-		case OPT_NIGHT_HOUR:
-			buffer[0] = getNumber(options[OPT_NIGHT_HOUR],1,'0');
-			buffer[1] = getNumber(options[OPT_NIGHT_HOUR],0,'0');
-			drawString(170,Y_3,buffer,2);
+		case DIAG_LINES:
+			value = dispStats.lines;
 			break;
-		case OPT_NIGHT_MIN:
-			buffer[0] = getNumber(options[OPT_NIGHT_MIN],1,'0');
-			buffer[1] = getNumber(options[OPT_NIGHT_MIN],0,'0');
-			drawString(200,Y_3,buffer,2);
+		case DIAG_FILLS:
+			value = dispStats.fills;
 			break;
-		case OPT_NIGHT_RED:
-			buffer[0] = getNumber(options[index],2,' ');
-			buffer[1] = getNumber(options[index],1,' ');
-			buffer[2] = getNumber(options[index],0,'0');
-			buffer[3] = '%';
-			drawString(180,Y_4,buffer,4);
+		case DIAG_CHARS:
+			value = dispStats.chars;
 			break;
-		case OPT_NIGHT_GRE:
-			buffer[0] = getNumber(options[index],2,' ');
-			buffer[1] = getNumber(options[index],1,' ');
-			buffer[2] = getNumber(options[index],0,'0');
-			buffer[3] = '%';
-			drawString(180,Y_5,buffer,4);
+#endif
+		case DIAG_RENDER:
+			value = renderTime;
 			break;
-		case OPT_NIGHT_BLU:
-			buffer[0] = getNumber(options[index],2,' ');
-			buffer[1] = getNumber(options[index],1,' ');
-			buffer[2] = getNumber(options[index],0,'0');
-			buffer[3] = '%';
-			drawString(180,Y_6,buffer,4);
+		case DIAG_RENDER_MAX:
+			value = renderTimeMax;
 			break;
-		case OPT_NIGHT_TEMP:
-			buffer[0] = getNumber(options[index],2,' ');
-			buffer[1] = getNumber(options[index],1,' ');
-			buffer[2] = getNumber(options[index],0,'0');
-			buffer[3] = '';
-			buffer[4] = 'C';
-			drawString(175,Y_7,buffer,5);
+		case DIAG_LATE:
+			value = schedLateMax(tasks, NUM_TASKS);
 			break;
-		case OPT_HOUR:
-			buffer[0] = getNumber(options[OPT_HOUR],1,'0');
-			buffer[1] = getNumber(options[OPT_HOUR],0,'0');
-			drawString(250,Y_3,buffer,2);
+		case DIAG_MISSES:
+			value = schedMisses(tasks, NUM_TASKS);
 			break;
-		case OPT_MIN:
-			buffer[0] = getNumber(options[OPT_MIN],1,'0');
-			buffer[1] = getNumber(options[OPT_MIN],0,'0');
-			drawString(280,Y_3,buffer,2);
+		case DIAG_IDLE:
+			value = idleRatio;
 			break;
-		case OPT_CLOCK:
-			buffer[0] = getNumber(options[index],2,' ');
-			buffer[1] = getNumber(options[index],1,' ');
-			buffer[2] = getNumber(options[index],0,'0');
-			drawString(260,Y_4,buffer,3);
+		case DIAG_WAKEUPS:
+			value = wakeupRate;
 			break;
 	}
+	formatLong(buffer, value, 10);
+	drawTextField(190, DIAG_Y(row), 120, buffer, 10);
 }
 
-void drawData(uint8_t index)
+void drawLogEntry(logEntry *entry)
 {
-	switch(index)
+	// The oldest entry sits at the right end of the scroll area. Its memory is
+	// overwritten with the new entry and the scroll offset is advanced, which moves
+	// all entries to the right and shows the new one next to the labels.
+	uint16_t x = DISP_MAX_X + 1 - scrollFixed - logScroll - LOG_WIDTH;
+
+	drawTextField(x+4, LOG_Y_TIME, LOG_WIDTH-5, buffer, formatTime(buffer, entry->hour, entry->min));
+
+	if(entry->temp == LOG_INVALID)
+		drawTextField(x+4, LOG_Y_TEMP, LOG_WIDTH-5, "--C", 4);
+	else // the sensor stays below 100 degree celsius, the leading blank does not fit
+		drawTextField(x+4, LOG_Y_TEMP, LOG_WIDTH-5, buffer + 1, formatValue(buffer, entry->temp, FMT_TEMP) - 1);
+
+	if(entry->hygro == LOG_INVALID)
+		drawTextField(x+4, LOG_Y_HYGRO, LOG_WIDTH-5, "--%", 3);
+	else
+		drawTextField(x+4, LOG_Y_HYGRO, LOG_WIDTH-5, buffer, formatValue(buffer, entry->hygro, FMT_PERCENT));
+	drawLine(x+LOG_WIDTH-1,0,x+LOG_WIDTH-1,239);
+
+	logScroll += LOG_WIDTH;
+	if(logScroll >= scrollSize)
+		logScroll = 0;
+	setScrollOffset(logScroll);
+}
+
+void logSensor(void)
+{
+	logEntry *entry = &sensorLog[logHead];
+	entry->hour = options[OPT_HOUR];
+	entry->min = options[OPT_MIN];
+	entry->temp = data[DAT_TEMP_OK] ? data[DAT_TEMP] : LOG_INVALID;
+	entry->hygro = data[DAT_HYGRO_OK] ? data[DAT_HYGRO] : LOG_INVALID;
+
+	if(++logHead == LOG_SIZE)
+		logHead = 0;
+	if(logCount < LOG_SIZE)
+		logCount++;
+	if(renderLog < LOG_SIZE)
+		renderLog++;
+}
+
+void drawGraphSample(uint16_t index, uint8_t connect)
+{
+	// The scroll offset is moved back by one column first. The column that appears at
+	// the right end of the scroll area is the oldest one, it is erased and the new
+	// sample is plotted into it, so the cost does not depend on the history length.
+	if(graphScroll == 0)
+		graphScroll = scrollSize;
+	graphScroll--;
+	uint16_t x = DISP_MAX_X - scrollFixed - graphScroll;
+	uint16_t prev = (index + HIST_SIZE - 1) % HIST_SIZE;
+
+	setColor(DISP_COL_BACK);
+	drawVLine(x, GRAPH_TOP, GRAPH_BOTTOM - GRAPH_TOP + 1);
+	setColor(DISP_COL_HYGRO);
+	drawGraphSegment(x, histHygro[index], connect ? histHygro[prev] : LOG_INVALID, GRAPH_SCALE_HYGRO);
+	setColor(DISP_COL_TEMP);
+	drawGraphSegment(x, histTemp[index], connect ? histTemp[prev] : LOG_INVALID, GRAPH_SCALE_TEMP);
+	setScrollOffset(graphScroll);
+}
+
+void drawGraphSegment(uint16_t x, uint8_t value, uint8_t prev, uint8_t scale)
+{
+	// a vertical line from the previous value keeps the plot connected on steep changes
+	if(value == LOG_INVALID)
+		return;
+	uint16_t y1 = GRAPH_BOTTOM - value * scale;
+	uint16_t y2 = y1;
+	if(prev != LOG_INVALID)
+		y2 = GRAPH_BOTTOM - prev * scale;
+	if(y2 < y1)
 	{
-		case DAT_TEMP:
-		case DAT_TEMP_OK:
-			if(data[DAT_TEMP_OK])
-			{
-				buffer[0] = getNumber(data[DAT_TEMP],2,' ');
-				buffer[1] = getNumber(data[DAT_TEMP],1,' ');
-				buffer[2] = getNumber(data[DAT_TEMP],0,'0');
-				buffer[3] = '';
-				buffer[4] = 'C';
-				drawString(255,Y_7,buffer,5);
-			}
-			else
-			{
-				drawString(255,Y_7," --C",5);
-			}
-			break;
-		case DAT_HYGRO:
-		case DAT_HYGRO_OK:
-			if(data[DAT_HYGRO_OK])
-			{
-				buffer[0] = getNumber(data[DAT_HYGRO],2,' ');
-				buffer[1] = getNumber(data[DAT_HYGRO],1,' ');
-				buffer[2] = getNumber(data[DAT_HYGRO],0,'0');
-				buffer[3] = '%';
-				drawString(260,Y_1,buffer,4);
-			}
-			else
-			{
-				drawString(260,Y_1," --%",4);
-			}
-			break;
-		case DAT_DAYTIME:
-			if(data[DAT_DAYTIME] == DAYTIME_DAY)
-				drawString(250,Y_2,"Tag",3);
-			else
-				drawString(250,Y_2,"Nacht",5);
-			break;
+		uint16_t swap = y1;
+		y1 = y2;
+		y2 = swap;
+	}
+	drawVLine(x, y1, y2 - y1 + 1);
+}
+
+void histSample(void)
+{
+	uint8_t temp = data[DAT_TEMP] > HIST_MAX_TEMP ? HIST_MAX_TEMP : data[DAT_TEMP];
+	uint8_t hygro = data[DAT_HYGRO] > HIST_MAX_HYGRO ? HIST_MAX_HYGRO : data[DAT_HYGRO];
+	histTemp[histHead] = data[DAT_TEMP_OK] ? temp : LOG_INVALID;
+	histHygro[histHead] = data[DAT_HYGRO_OK] ? hygro : LOG_INVALID;
+
+	if(++histHead == HIST_SIZE)
+		histHead = 0;
+	if(histCount < HIST_SIZE)
+		histCount++;
+	if(renderGraph < HIST_SIZE)
+		renderGraph++;
+}
+
+uint8_t formatValue(char *dest, uint8_t value, uint8_t format)
+{
+	// the digits are found by subtracting, the ATmega has no hardware divider
+	uint8_t hundreds = 0;
+	uint8_t tens = 0;
+	while(value >= 100)
+	{
+		value -= 100;
+		hundreds++;
+	}
+	while(value >= 10)
+	{
+		value -= 10;
+		tens++;
+	}
+
+	uint8_t length = 0;
+	if(format == FMT_2DIGIT)
+		dest[length++] = tens + '0';
+	else
+	{
+		dest[length++] = hundreds ? hundreds + '0' : ' ';
+		dest[length++] = (hundreds || tens) ? tens + '0' : ' ';
+	}
+	dest[length++] = value + '0';
+
+	if(format == FMT_PERCENT)
+		dest[length++] = '%';
+	else if(format == FMT_TEMP)
+	{
+		dest[length++] = '';
+		dest[length++] = 'C';
 	}
+	return length;
 }
 
-char getNumber(uint8_t value, uint8_t pos, char fill)
+uint8_t formatTime(char *dest, uint8_t hour, uint8_t min)
 {
-	for(uint8_t i=0; i < pos; i++)
-		value /= 10;
-	if(!value)
-		return fill;
-	return (value%10+'0');
+	formatValue(dest, hour, FMT_2DIGIT);
+	dest[2] = ':';
+	formatValue(dest + 3, min, FMT_2DIGIT);
+	return 5;
+}
+
+void formatLong(char *dest, uint32_t value, uint8_t length)
+{
+	static const uint32_t powers[] PROGMEM = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+	uint8_t leading = 1;
+	for(uint8_t i = 0; i < length; i++)
+	{
+		uint8_t place = length - 1 - i;
+		uint8_t digit = 0;
+		if(place < sizeof(powers) / sizeof(powers[0]))
+		{
+			uint32_t power = pgm_read_dword(&powers[place]);
+			while(value >= power)
+			{
+				value -= power;
+				digit++;
+			}
+		}
+		if(digit || !place)
+			leading = 0;
+		dest[i] = leading ? ' ' : digit + '0';
+	}
 }
 
 void loadOptions(void)
 {
-	cli(); // while reading from EEPROM, disable interrupts
+	uint8_t sreg = SREG; // while reading from EEPROM, disable interrupts
+	cli();
 	uint8_t checkByte;
 	while(readBit(&EECR, EEWE)); // wait for possible writing to finish
 	EEAR = 0;
@@ -509,6 +1034,11 @@ void loadOptions(void)
 			options[i] = EEDR; // load target data to cache
 			setBit(&EECR, EERE, 0); // disable read operation
 		}
+		while(readBit(&EECR, EEWE)); // wait for possible writing to finish
+		EEAR = SAVED_FRACTION;
+		setBit(&EECR, EERE, 1); // enable read operation
+		clockFraction = EEDR;
+		setBit(&EECR, EERE, 0); // disable read operation
 	}
 	else
 	{
@@ -517,102 +1047,202 @@ void loadOptions(void)
 	EECR = 0; // clear any operation bits
 	for(uint8_t i = 0; i < NUM_OPT; i++)
 		optionsCache[i] = options[i];
-	sei(); // re-enable interrupts
+	SREG = sreg; // restore the interrupt state of the caller
 }
 
 void loadDefaultOptions(void)
 {
-	options[OPT_NONE] = MAX_NONE;
-	options[OPT_LIGHT] = OPT_LIGHT_AUTO;
-	options[OPT_DAY_HOUR] = 8;
-	options[OPT_DAY_MIN] = 0;
-	options[OPT_DAY_RED] = 25;
-	options[OPT_DAY_GRE] = 25;
-	options[OPT_DAY_BLU] = 0;
-	options[OPT_DAY_TEMP] = 0;
-	options[OPT_NIGHT_HOUR] = 22;
-	options[OPT_NIGHT_MIN] = 0;
-	options[OPT_NIGHT_RED] = 15;
-	options[OPT_NIGHT_GRE] = 7;
-	options[OPT_NIGHT_BLU] = 0;
-	options[OPT_NIGHT_TEMP] = 0;
-	options[OPT_HOUR] = 0;
-	options[OPT_MIN] = 0;
-	options[OPT_CLOCK] = 109;
+	for(uint8_t i = 0; i < NUM_OPT; i++)
+		options[i] = pgm_read_byte(&optionTable[i].preset);
 }
 
 void saveOptions(void)
 {
 	if(optionsChanged && getTimeDiff(T_ACTION) > SAVE_PERIOD)
 	{
-		cli(); // while writing, disable interrupts
+		// interrupts are only disabled for the timed write sequence of each byte, the
+		// timers keep running while the EEPROM is busy
+		uint8_t sreg;
 		optionsChanged = 0;
 		while(readBit(&EECR, EEWE)); // wait for possible writing to finish
 		EEAR = 0; // write target address
 		EEDR = SAVED_PATTERN; // write target data
+		sreg = SREG;
+		cli();
 		EECR = (1 << EEMWE);
 		EECR |= (1 << EEWE);
+		SREG = sreg;
 
 		for(uint8_t i=0; i < NUM_OPT; i++)
 		{
 			while(readBit(&EECR, EEWE)); // wait for possible writing to finish
 			EEAR = i+1; // write target address
 			EEDR = options[i]; // write target data
+			sreg = SREG;
+			cli();
 			EECR = (1 << EEMWE);
 			// the write enable bit has to be set within 4 cycles after master write enable
 			// setBit(...) is too slow!
 			EECR |= (1 << EEWE);
+			SREG = sreg;
 		}
 		while(readBit(&EECR, EEWE)); // wait for possible writing to finish
+		EEAR = SAVED_FRACTION; // write target address
+		EEDR = clockFraction; // write target data
+		sreg = SREG;
+		cli();
+		EECR = (1 << EEMWE);
+		EECR |= (1 << EEWE);
+		SREG = sreg;
+		while(readBit(&EECR, EEWE)); // wait for possible writing to finish
 		EECR = 0; // clear any operation bits
-		sei(); // re-enable interrupts
 	}
 }
 
 void handleTime(void)
 {
+#ifdef CLOCK_RTC
+	// the byte written by the interrupt is read at once, no locking is needed
+	while(rtcSeen != rtcCount)
+	{
+		rtcSeen++;
+		nextSecond();
+	}
+#else
+	// Run once per second by the scheduler. A second lasts OPT_CLOCK plus clockFraction/256 ms,
+	// the fraction is accumulated and every carry makes one second 1 ms longer.
 	clockCycle = CLOCK_PERIOD + options[OPT_CLOCK];
-	if(getTimeDiff(T_CLOCK) >= clockCycle)
+	uint8_t accu = clockAccu + clockFraction;
+	tasks[TASK_CLOCK].period = clockCycle + (accu < clockAccu);
+	clockAccu = accu;
+	nextSecond();
+	calibSeconds++;
+	handleCalibration();
+#endif
+}
+
+uint32_t getTimeOfDay(void)
+{
+	return options[OPT_HOUR] * 3600UL + options[OPT_MIN] * 60 + seconds;
+}
+
+void noteClockEdit(void)
+{
+#ifndef CLOCK_RTC
+	if(!calibEditing)
 	{
-		resetTimer(T_CLOCK);
-		seconds++;
-		if(seconds > MAX_SEC)
-		{
-			seconds -= MAX_SEC;
-			options[OPT_MIN]++;
-		}
-		if(options[OPT_MIN] > MAX_MIN)
-		{
-			options[OPT_MIN] = 0;
-			options[OPT_HOUR]++;
-		}
-		if(options[OPT_HOUR] > MAX_HOUR)
-		{
-			options[OPT_HOUR] = 0;
-		}
-		uint16_t minutesDay = options[OPT_DAY_HOUR] * 60 + options[OPT_DAY_MIN];
-		uint16_t minutesNight = options[OPT_NIGHT_HOUR] * 60 + options[OPT_NIGHT_MIN];
-		uint16_t minutesCurrent = options[OPT_HOUR] * 60 + options[OPT_MIN];
-		if(minutesDay < minutesNight)
-		{
-			if(minutesDay <= minutesCurrent && minutesCurrent < minutesNight)
-				data[DAT_DAYTIME] = DAYTIME_DAY;
-			else
-				data[DAT_DAYTIME] = DAYTIME_NIGHT;
-		}
+		calibEditing = 1;
+		calibStart = getTimeOfDay();
+		calibStartSeconds = calibSeconds;
+	}
+#endif
+}
+
+void handleCalibration(void)
+{
+#ifndef CLOCK_RTC
+	if(!calibEditing || data[DAT_OPTION] == OPT_HOUR || data[DAT_OPTION] == OPT_MIN)
+		return;
+	calibEditing = 0;
+
+	// the correction is the change of the time of day not explained by the running clock
+	int32_t correction = (int32_t)getTimeOfDay() - calibStart - (calibSeconds - calibStartSeconds);
+	correction %= SEC_DAY;
+	if(correction > SEC_DAY / 2)
+		correction -= SEC_DAY;
+	else if(correction < -SEC_DAY / 2)
+		correction += SEC_DAY;
+
+	calibCorrection += correction;
+	uint32_t elapsed = calibSeconds + calibCorrection; // real seconds since the reference
+	if(!calibValid || correction > CALIB_MAX_CORRECTION || correction < -CALIB_MAX_CORRECTION
+		|| calibCorrection > (int32_t)(elapsed / 16) || calibCorrection < -(int32_t)(elapsed / 16))
+	{
+		// the time was set, it is the new reference
+		calibValid = 1;
+		calibSeconds = 0;
+		calibCorrection = 0;
+		return;
+	}
+	if(calibSeconds < CALIB_MIN_INTERVAL)
+		return;
+
+	// The clock counted calibSeconds while elapsed seconds passed, so the cycle has to be scaled
+	// by calibSeconds / elapsed: cycle -= cycle * correction / elapsed. The ratio is taken with
+	// 16 fractional bits first to stay within 32 bit, the correction is below 1/16 of elapsed.
+	while(calibCorrection > INT16_MAX || calibCorrection < -INT16_MAX)
+	{
+		calibCorrection /= 2;
+		elapsed /= 2;
+	}
+	int32_t cycle = ((int32_t)(CLOCK_PERIOD + options[OPT_CLOCK]) << 8) + clockFraction;
+	int32_t ratio = divRound(calibCorrection * 65536L, elapsed);
+	cycle -= divRound(cycle * ratio, 65536L);
+	if(cycle < (int32_t)CLOCK_PERIOD << 8)
+		cycle = (int32_t)CLOCK_PERIOD << 8;
+	else if(cycle > (((int32_t)CLOCK_PERIOD + MAX_CLOCK) << 8) + 255)
+		cycle = (((int32_t)CLOCK_PERIOD + MAX_CLOCK) << 8) + 255;
+	options[OPT_CLOCK] = (cycle >> 8) - CLOCK_PERIOD;
+	clockFraction = cycle;
+	optionsChanged = 1;
+	resetTimer(T_ACTION); // stored with the next save
+
+	calibSeconds = 0;
+	calibCorrection = 0;
+#endif
+}
+
+int32_t divRound(int32_t value, int32_t divisor)
+{
+	// the division truncates towards zero, half the divisor is added away from zero first
+	if(value < 0)
+		return (value - divisor / 2) / divisor;
+	return (value + divisor / 2) / divisor;
+}
+
+void nextSecond(void)
+{
+	seconds++;
+	uint8_t newMinute = 0;
+	if(seconds > MAX_SEC)
+	{
+		seconds = 0;
+		options[OPT_MIN]++;
+		newMinute = 1;
+	}
+	if(options[OPT_MIN] > MAX_MIN)
+	{
+		options[OPT_MIN] = 0;
+		options[OPT_HOUR]++;
+	}
+	if(newMinute && options[OPT_MIN] % HIST_MINUTES == 0)
+		histSample();
+	if(options[OPT_HOUR] > MAX_HOUR)
+	{
+		options[OPT_HOUR] = 0;
+	}
+	uint16_t minutesDay = options[OPT_DAY_HOUR] * 60 + options[OPT_DAY_MIN];
+	uint16_t minutesNight = options[OPT_NIGHT_HOUR] * 60 + options[OPT_NIGHT_MIN];
+	uint16_t minutesCurrent = options[OPT_HOUR] * 60 + options[OPT_MIN];
+	if(minutesDay < minutesNight)
+	{
+		if(minutesDay <= minutesCurrent && minutesCurrent < minutesNight)
+			data[DAT_DAYTIME] = DAYTIME_DAY;
 		else
-		{
-			if(minutesNight <= minutesCurrent && minutesCurrent < minutesDay)
-				data[DAT_DAYTIME] = DAYTIME_NIGHT;
-			else
-				data[DAT_DAYTIME] = DAYTIME_DAY;
-		}
+			data[DAT_DAYTIME] = DAYTIME_NIGHT;
+	}
+	else
+	{
+		if(minutesNight <= minutesCurrent && minutesCurrent < minutesDay)
+			data[DAT_DAYTIME] = DAYTIME_NIGHT;
+		else
+			data[DAT_DAYTIME] = DAYTIME_DAY;
 	}
 }
 
 void handleButton(void)
 {
-	if(!buttonStateOld && ENC_BTN && getTimeDiff(T_BTN) > BTN_PERIOD)
+	if(!buttonStateOld && ENC_BTN && getTimeDiff(T_BTN) > BTN_PERIOD && data[DAT_SCREEN] == SCREEN_MAIN)
 	{
 		resetTimer(T_BTN);
 		resetTimer(T_ACTION);
@@ -621,32 +1251,53 @@ void handleButton(void)
 			data[DAT_OPTION] = 0;
 	}
 	buttonStateOld = ENC_BTN;
+	if(getTimeDiff(T_ACTION) > ACTION_PERIOD)
+		data[DAT_OPTION] = OPT_NONE;
 }
 
 void handleEncoder(void)
 {
-	uint8_t encState = readBit(ENC_A) + (readBit(ENC_B) << 1);
+	uint8_t encState = readBitFast(ENC_A) + (readBitFast(ENC_B) << 1);
 	if(encState == 0 && encStateOld == 1 && data[DAT_OPTION] != OPT_NONE)
 	{
 		resetTimer(T_ACTION);
 		optionsChanged = 1;
-		if(options[data[DAT_OPTION]] < optionMax[data[DAT_OPTION]])
-			options[data[DAT_OPTION]]++;
-		else
-			options[data[DAT_OPTION]] = 0;
+		changeOption(data[DAT_OPTION], 1);
 	}
 	else if(encState == 2 && encStateOld == 3 && data[DAT_OPTION] != OPT_NONE)
 	{
 		resetTimer(T_ACTION);
 		optionsChanged = 1;
-		if(options[data[DAT_OPTION]] > 0)
-			options[data[DAT_OPTION]]--;
-		else
-			options[data[DAT_OPTION]] = optionMax[data[DAT_OPTION]];
+		changeOption(data[DAT_OPTION], -1);
+	}
+	else if(encState == 0 && encStateOld == 1)
+	{
+		// without a selected option the encoder flips through the screens
+		if(++data[DAT_SCREEN] == NUM_SCREENS)
+			data[DAT_SCREEN] = SCREEN_MAIN;
+	}
+	else if(encState == 2 && encStateOld == 3)
+	{
+		if(data[DAT_SCREEN]-- == SCREEN_MAIN)
+			data[DAT_SCREEN] = NUM_SCREENS - 1;
 	}
 	encStateOld = encState;
 }
 
+void changeOption(uint8_t index, int8_t direction)
+{
+	optionDescriptor desc;
+	memcpy_P(&desc, &optionTable[index], sizeof(desc));
+	if(index == OPT_HOUR || index == OPT_MIN)
+		noteClockEdit();
+	int16_t value = options[index] + direction * desc.step;
+	if(value > desc.max)
+		value = desc.wrap == WRAP_AROUND ? desc.min : desc.max;
+	else if(value < desc.min)
+		value = desc.wrap == WRAP_AROUND ? desc.max : desc.min;
+	options[index] = value;
+}
+
 void handleLight(void)
 {
 	uint8_t light = LIGHT_OFF;
@@ -671,120 +1322,214 @@ void handleLight(void)
 			light = LIGHT_NIGHT;
 	}
 
-	if(lightOption || light != lastLight)
+	uint8_t target[NUM_COL]; // brightness in percent
+	if(light == LIGHT_OFF)
 	{
-		lastLight = light;
-		if(light == LIGHT_OFF)
-		{
-			duty[COL_RED] = 0;
-			duty[COL_GRE] = 0;
-			duty[COL_BLU] = 0;
-		}
-		else if(light == LIGHT_ON)
-		{
-			duty[COL_RED] = MAX_PWM;
-			duty[COL_GRE] = MAX_PWM;
-			duty[COL_BLU] = MAX_PWM;
-		}
-		else if(light == LIGHT_DAY)
-		{
-			duty[COL_RED] = options[OPT_DAY_RED];
-			duty[COL_GRE] = options[OPT_DAY_GRE];
-			duty[COL_BLU] = options[OPT_DAY_BLU];
-		}
-		else if(light == LIGHT_NIGHT)
+		target[COL_RED] = 0;
+		target[COL_GRE] = 0;
+		target[COL_BLU] = 0;
+	}
+	else if(light == LIGHT_ON)
+	{
+		target[COL_RED] = MAX_PWM;
+		target[COL_GRE] = MAX_PWM;
+		target[COL_BLU] = MAX_PWM;
+	}
+	else if(light == LIGHT_DAY)
+	{
+		target[COL_RED] = options[OPT_DAY_RED];
+		target[COL_GRE] = options[OPT_DAY_GRE];
+		target[COL_BLU] = options[OPT_DAY_BLU];
+	}
+	else
+	{
+		target[COL_RED] = options[OPT_NIGHT_RED];
+		target[COL_GRE] = options[OPT_NIGHT_GRE];
+		target[COL_BLU] = options[OPT_NIGHT_BLU];
+	}
+
+	// only the automatic change between day and night fades in over OPT_RAMP minutes, a change
+	// of OPT_LIGHT and the preview of an option being edited are shown at once
+	uint16_t fadeLength = 0;
+	if(options[OPT_LIGHT] == OPT_LIGHT_AUTO && lightMode == OPT_LIGHT_AUTO)
+		fadeLength = options[OPT_RAMP] * 60;
+	lightMode = options[OPT_LIGHT];
+	if(fadeSet(light, target, lightOption, fadeLength))
+		lightOutput();
+}
+
+void handleFade(void)
+{
+	if(fadeStep())
+		lightOutput();
+}
+
+void lightOutput(void)
+{
+	for(uint8_t i = 0; i < NUM_COL; i++)
+		duty[i] = fadeDuty(i);
+	pwmUpdate();
+}
+
+#ifdef PWM_EDGES
+void pwmUpdate(void)
+{
+	static const uint8_t masks[NUM_COL] = {LED_MASK_RED, LED_MASK_GRE, LED_MASK_BLU};
+
+	// the interrupt only swaps the buffers while pwmPending is set, so after clearing it
+	// the inactive buffer can be written without tearing the period being played. The call
+	// of pwmBuild() keeps the compiler from moving the writes behind pwmPending.
+	pwmPending = 0;
+	uint8_t target = pwmActive ^ 1;
+	pwmCount[target] = pwmBuild(duty, masks, pwmSchedule[target]);
+	pwmPending = 1;
+}
+#elif defined(PWM_HARDWARE)
+void pwmUpdate(void)
+{
+	// the compare registers are double buffered by the timers, a new duty-cycle starts
+	// with the next period. The full duty-cycle lies above the top and keeps the output high,
+	// a compare of zero disconnects the output, at the bottom it would still give a pulse.
+	// Timer1 resolves the 12 bit, Timer2 only the upper 8 bit.
+	uint16_t red = (uint32_t)duty[COL_RED] * (PWM_TOP + 1) / FADE_LEVEL_MAX;
+	uint16_t blue = (uint32_t)duty[COL_BLU] * (PWM_TOP + 1) / FADE_LEVEL_MAX;
+	uint8_t green = duty[COL_GRE] >> 4;
+	OCR1A = red;
+	OCR1B = blue;
+	OCR2 = green;
+	setBit(&TCCR1A, COM1A1, red != 0);
+	setBit(&TCCR1A, COM1B1, blue != 0);
+	setBit(&TCCR2, COM21, green != 0);
+}
+#else
+void pwmUpdate(void)
+{
+	// the steps of the software pwm are percent, the lowest brightness is rounded up to
+	// one step instead of switching the channel off
+	uint8_t steps[NUM_COL];
+	for(uint8_t i = 0; i < NUM_COL; i++)
+	{
+		steps[i] = ((uint32_t)duty[i] * MAX_PWM + FADE_LEVEL_MAX / 2) / FADE_LEVEL_MAX;
+		if(!steps[i] && duty[i])
+			steps[i] = 1;
+	}
+
+	// the interrupt only takes pwmNext over while pwmPending is set
+	pwmPending = 0;
+	for(uint8_t i = 0; i < NUM_COL; i++)
+		pwmNext[i] = steps[i];
+	pwmPending = 1;
+}
+#endif
+
+void handleSensorTask(void)
+{
+	uint8_t retVal = handleSensor();
+#if !defined(PWM_HARDWARE) && !defined(PWM_EDGES)
+	setBit(&TIMSK, OCIE1A, 1); // enable output compare match interrupt
+#endif
+	if(retVal == SENS_OK)
+		sensError = 0;
+	else
+	{
+		sensError++;
+		if(sensError > SENS_MAX_ERR)
 		{
-			duty[COL_RED] = options[OPT_NIGHT_RED];
-			duty[COL_GRE] = options[OPT_NIGHT_GRE];
-			duty[COL_BLU] = options[OPT_NIGHT_BLU];
+			data[DAT_HYGRO_OK] = 0;
+			data[DAT_TEMP_OK] = 0;
 		}
 	}
+	logSensor();
 }
 
 uint8_t handleSensor(void)
 {
-	if(getTimeDiff(T_WAIT) > SENS_PERIOD)
-	{
-		uint8_t inputBits[40];
-		for(uint8_t i = 0; i < 40; i++)
-			inputBits[i] = 0;
-		uint8_t inputData[5];
-		uint8_t index = 0;
-		uint16_t timeout = 0;
-		
-		resetTimer(T_WAIT);
-		setBit(SENS_OUT,1);
-		while(getTimeDiff(T_WAIT) < 18);
-		setBit(&TIMSK, OCIE1A, 0); // disable pwm output compare match interrupt
-		setBit(SENS_OUT,0);
-
-		TCNT0 = 0;
-		while(TCNT0 < 30)
-		{
-			if(++timeout == SENS_TIMEOUT)
-				return 2;
-			if(SENS_IN)
-				TCNT0 = 0;
-		}
+	uint8_t inputBits[40];
+	for(uint8_t i = 0; i < 40; i++)
+		inputBits[i] = 0;
+	uint8_t inputData[5];
+	uint8_t index = 0;
+	uint16_t timeout = 0;
+	
+	resetTimer(T_WAIT);
+	setBitHigh(SENS_OUT);
+	while(getTimeDiff(T_WAIT) < 18);
+	// the step interrupt of the software pwm is paused while the bits are timed. The edge
+	// schedule keeps running, it interrupts a few times per period only and a paused timer
+	// would run past the compare value loaded late.
+#if !defined(PWM_HARDWARE) && !defined(PWM_EDGES)
+	setBit(&TIMSK, OCIE1A, 0); // disable pwm output compare match interrupt
+#endif
+	setBitLow(SENS_OUT);
+
+	// Timer0 is read relative to a start value and never reset, it may carry the main-time
+	uint8_t start = TCNT0;
+	while((uint8_t)(TCNT0 - start) < 30)
+	{
+		if(++timeout == SENS_TIMEOUT)
+			return 2;
+		if(SENS_IN)
+			start = TCNT0;
+	}
+	while(!SENS_IN)
+		if(++timeout == SENS_TIMEOUT)
+			return 3;
+	while(SENS_IN)
+		if(++timeout == SENS_TIMEOUT)
+			return 4;
+	timeout = 0;
+
+	while(index < 40)
+	{
 		while(!SENS_IN)
 			if(++timeout == SENS_TIMEOUT)
-				return 3;
+				return 5;
+		start = TCNT0;
 		while(SENS_IN)
 			if(++timeout == SENS_TIMEOUT)
-				return 4;
-		timeout = 0;
+				return 6;
 
-		while(index < 40)
-		{
-			while(!SENS_IN)
-				if(++timeout == SENS_TIMEOUT)
-					return 5;
-			TCNT0 = 0;
-			while(SENS_IN)
-				if(++timeout == SENS_TIMEOUT)
-					return 6;
-
-			if(TCNT0 > 50)
-				inputBits[index] = 1;
-			index++;
-		}
+		if((uint8_t)(TCNT0 - start) > 50)
+			inputBits[index] = 1;
+		index++;
+	}
 
-		setBit(&TIMSK, OCIE1A, 1); // enable pwm output compare match interrupt
+#if !defined(PWM_HARDWARE) && !defined(PWM_EDGES)
+	setBit(&TIMSK, OCIE1A, 1); // enable pwm output compare match interrupt
+#endif
 
-		for(uint8_t i = 0; i < 40; i++)
-		{
-			index = i / 8;
-			uint8_t bit = 7 - (i%8);
-			setBit(inputData+index,bit,inputBits[i]);
-		}
+	for(uint8_t i = 0; i < 40; i++)
+	{
+		index = i / 8;
+		uint8_t bit = 7 - (i%8);
+		setBit(inputData+index,bit,inputBits[i]);
+	}
 
-		uint8_t sum = inputData[0] + inputData[1] + inputData[2] + inputData[3];
-		if(sum != inputData[4])
-		{
-			return 7;
-		}
+	uint8_t sum = inputData[0] + inputData[1] + inputData[2] + inputData[3];
+	if(sum != inputData[4])
+	{
+		return 7;
+	}
+	else
+	{
+		data[DAT_HYGRO_OK] = 1;
+		uint16_t hygro = (inputData[0] << 8) + inputData[1];
+		data[DAT_HYGRO] = hygro / 10;
+		if(hygro % 10 >= 5)
+			data[DAT_HYGRO]++;
+
+		if(readBit(inputData+2,7))
+			data[DAT_TEMP_OK] = 0;
 		else
 		{
-			data[DAT_HYGRO_OK] = 1;
-			uint16_t hygro = (inputData[0] << 8) + inputData[1];
-			data[DAT_HYGRO] = hygro / 10;
-			if(hygro % 10 >= 5)
-				data[DAT_HYGRO]++;
-
-			if(readBit(inputData+2,7))
-				data[DAT_TEMP_OK] = 0;
-			else
-			{
-				data[DAT_TEMP_OK] = 1;
-				uint16_t temp = (inputData[2] << 8) + inputData[3];
-				data[DAT_TEMP] = temp / 10;
-				if(temp % 10 >= 5)
-					data[DAT_TEMP]++;
-			}
-			return SENS_OK;
+			data[DAT_TEMP_OK] = 1;
+			uint16_t temp = (inputData[2] << 8) + inputData[3];
+			data[DAT_TEMP] = temp / 10;
+			if(temp % 10 >= 5)
+				data[DAT_TEMP]++;
 		}
+		return SENS_OK;
 	}
-	return SENS_NOT_READ;
 }
 
 void handleHeater(void)
@@ -794,9 +1539,9 @@ void handleHeater(void)
 		temp = options[OPT_NIGHT_TEMP];
 
 	if(!data[DAT_TEMP_OK] || data[DAT_TEMP] > temp)
-		setBit(HEAT, 0);
+		setBitLow(HEAT);
 	else
-		setBit(HEAT, 1);
+		setBitHigh(HEAT);
 }
 
 void handleDisplay(void)
@@ -805,87 +1550,204 @@ void handleDisplay(void)
 	{
 		if(options[i] != optionsCache[i])
 		{
-			uint8_t cache = options[i];
-			options[i] = optionsCache[i];
-			setColor(DISP_COL_BACK);
-			drawOption(i);
-			if(i == data[DAT_OPTION])
-				setColor(DISP_COL_OPT);
-			else
-				setColor(DISP_COL_FRONT);
-			options[i] = cache;
-			optionsCache[i] = cache;
-			drawOption(i);
+			optionsCache[i] = options[i];
+			renderOptions |= (1UL << i);
 		}
 	}
 	for(uint8_t i = 0; i < NUM_DAT; i++)
 	{
 		if(data[i] != dataCache[i])
 		{
-			if(i == DAT_OPTION)
+			if(i == DAT_SCREEN)
 			{
-				setColor(DISP_COL_FRONT);
-				drawOption(dataCache[i]);
-				setColor(DISP_COL_OPT);
-				drawOption(data[i]);
-				dataCache[i] = data[i];
+				// the log and graph screens scroll between the label strip and the right edge
+				if(data[i] == SCREEN_LOG)
+					setScrollArea(LOG_WIDTH, 0);
+				else if(data[i] == SCREEN_GRAPH)
+					setScrollArea(GRAPH_WIDTH, 0);
+				else
+					setScrollArea(0, 0);
+				logScroll = 0;
+				graphScroll = 0;
+				renderLog = logCount;
+				renderGraph = histCount;
+				renderStep = RENDER_CLEAR;
+				renderOptions = (1UL << NUM_OPT) - 1;
+				renderData = (1 << NUM_DAT) - 1;
+				renderDiag = (1U << NUM_DIAG) - 1;
+				for(uint8_t n = 0; n < NUM_OPT; n++)
+					optionText[n].length = 0; // the screen is cleared, nothing is left to compare
+				for(uint8_t n = 0; n < NUM_DAT; n++)
+					dataText[n].length = 0;
 			}
-			else
+			else if(i == DAT_OPTION)
 			{
-				uint8_t cache = data[i];
-				data[i] = dataCache[i];
-				setColor(DISP_COL_BACK);
-				drawData(i);
-				setColor(DISP_COL_FRONT);
-				data[i] = cache;
-				dataCache[i] = cache;
-				drawData(i);
+				renderOptions |= (1UL << dataCache[i]); // redraw in normal color
+				renderOptions |= (1UL << data[i]); // redraw as selected
+				optionText[dataCache[i]].length = 0; // the color changes, every character has to be drawn
+				optionText[data[i]].length = 0;
 			}
+			else if(i == DAT_TEMP_OK)
+				renderData |= (1 << DAT_TEMP); // drawn together with its value
+			else if(i == DAT_HYGRO_OK)
+				renderData |= (1 << DAT_HYGRO);
+			else
+				renderData |= (1 << i);
+			dataCache[i] = data[i];
 		}
 	}
+
 }
 
-void resetTimer(uint8_t index)
+void handleDiag(void)
 {
-	if(index < NUM_TIMERS)
+	// the task runs once per second, so the counters are per second
+	idleRatio = idleTicks / (DIAG_PERIOD / 100);
+	wakeupRate = idleWakeups;
+	idleTicks = 0;
+	idleWakeups = 0;
+	if(data[DAT_SCREEN] == SCREEN_DIAG)
+		renderDiag = (1U << NUM_DIAG) - 1;
+}
+
+uint8_t renderDisplay(void)
+{
+	// draw pending parts until the time budget of this iteration is used up
+	resetTimer(T_RENDER);
+	if(!renderNext())
+		return 0;
+	while(getTimeDiff(T_RENDER) < RENDER_BUDGET && renderNext());
+	renderTime = getTimeDiff(T_RENDER);
+	if(renderTime > renderTimeMax)
+		renderTimeMax = renderTime;
+	return 1;
+}
+
+void idleSleep(uint32_t now)
+{
+	// the main-time is checked with disabled interrupts, sei() delays them until sleep
+	// is entered, so a tick arriving in between can not be missed
+	uint8_t slept = 0;
+	cli();
+	while(timer == now)
 	{
-		cli();
-		timers[index] = timer;
+		slept = 1;
+		sleep_enable();
 		sei();
+		sleep_cpu();
+		sleep_disable();
+		idleWakeups++; // mostly the pwm interrupt, the cpu sleeps again until the tick
+		cli();
 	}
+	sei();
+	if(slept)
+		idleTicks++; // a tick with sleep, how much of it was used before is not measured
 }
 
-uint16_t getTimeDiff(uint8_t index)
+uint32_t getTicks(void)
 {
-	if(index < NUM_TIMERS)
+	// the four bytes are read twice, if the interrupt changed the counter in between the
+	// reads differ and are repeated, so the interrupts never have to be disabled
+	uint32_t first, second;
+	do
 	{
-		cli();
-		uint16_t result = timer - timers[index];
-		sei();
-		return result;
-	}
+		first = timer;
+		second = timer;
+	} while(first != second);
+	return first;
+}
+
+void resetTimer(uint8_t index)
+{
+	if(index < NUM_TIMERS)
+		timers[index] = getTicks();
+}
+
+uint32_t getTimeDiff(uint8_t index)
+{
+	if(index < NUM_TIMERS)
+		return getTicks() - timers[index];
 	return 0;
 }
 
+#ifdef PWM_EDGES
 ISR(TIMER1_COMPA_vect) // PWM
 {
-	pwmCycle++;
-	if(pwmCycle > MAX_PWM)
+	// The timer restarted at the end of the last segment, start the next one. Segments too
+	// short to load the compare in time are played by waiting for the timer, pwmBuild()
+	// ends every period with a long segment.
+	pwmSegment *segment = &pwmSchedule[pwmActive][pwmIndex];
+	uint16_t start = 0;
+	PORTD = (PORTD & ~LED_MASK) | segment->mask;
+	while(segment->length < PWM_MIN_GAP)
+	{
+		start += segment->length;
+		segment++;
+		pwmIndex++;
+		while(TCNT1 < start);
+		PORTD = (PORTD & ~LED_MASK) | segment->mask;
+	}
+	OCR1A = start + segment->length - 1;
+	if(++pwmIndex >= pwmCount[pwmActive])
+	{
+		pwmIndex = 0;
+		if(pwmPending)
+		{
+			pwmActive ^= 1;
+			pwmPending = 0;
+		}
+	}
+}
+#elif !defined(PWM_HARDWARE)
+ISR(TIMER1_COMPA_vect) // PWM
+{
+	// new duty-cycles are taken over at the start of a period only, all channels switch
+	// with a single write of the port
+	if(++pwmCycle >= MAX_PWM)
 	{
-		setBit(LED_RED,duty[COL_RED]);
-		setBit(LED_GRE,duty[COL_GRE]);
-		setBit(LED_BLU,duty[COL_BLU]);
 		pwmCycle = 0;
+		if(pwmPending)
+		{
+			pwmDuty[COL_RED] = pwmNext[COL_RED];
+			pwmDuty[COL_GRE] = pwmNext[COL_GRE];
+			pwmDuty[COL_BLU] = pwmNext[COL_BLU];
+			pwmPending = 0;
+		}
+	}
+	uint8_t mask = 0;
+	if(pwmCycle < pwmDuty[COL_RED])
+		mask |= LED_MASK_RED;
+	if(pwmCycle < pwmDuty[COL_GRE])
+		mask |= LED_MASK_GRE;
+	if(pwmCycle < pwmDuty[COL_BLU])
+		mask |= LED_MASK_BLU;
+	PORTD = (PORTD & ~LED_MASK) | mask;
+}
+#endif
+
+#ifdef CLOCK_RTC
+ISR(TIMER0_OVF_vect) // internal clock
+{
+	tickFraction += TICK_STEP;
+	if(tickFraction >= 1000)
+	{
+		tickFraction -= 1000;
+		timer++;
 	}
-	if(pwmCycle == duty[COL_RED])
-		setBit(LED_RED,0);
-	if(pwmCycle == duty[COL_GRE])
-		setBit(LED_GRE,0);
-	if(pwmCycle == duty[COL_BLU])
-		setBit(LED_BLU,0);
 }
 
+ISR(TIMER2_OVF_vect) // real time clock
+{
+	rtcCount++;
+}
+#elif defined(PWM_HARDWARE)
+ISR(TIMER1_OVF_vect) // internal clock
+{
+	timer++;
+}
+#else
 ISR(TIMER2_COMP_vect) // internal clock
 {
 	timer++;
 }
+#endif
@@ -0,0 +1,68 @@
+// ==================================== [pwmEdges.c] =============================
+/*
+*	This library builds the edge schedule of the LED pwm, one period as a list of
+*	segments with the channels switched on and their duration in timer counts.
+*
+*	Author: Tobias Braechter
+*	Last update: 2020-06-21
+*
+*/
+
+#include "pwmEdges.h"
+#include "fade.h"
+
+uint8_t pwmBuild(const uint16_t *duty, const uint8_t *masks, pwmSegment *schedule)
+{
+	// Channels on for up to half the period switch on at the start and off after their
+	// on-time, the others switch off at the start and on for the rest of the period. All
+	// edges lie in the first half, so the last segment leaves time to load the next compare.
+	uint16_t edges[PWM_CHANNELS];
+	uint8_t edgeMasks[PWM_CHANNELS]; // channels toggled at each edge
+	uint8_t count = 0;
+	uint8_t on = 0;
+	for(uint8_t i = 0; i < PWM_CHANNELS; i++)
+	{
+		uint16_t time = (uint32_t)duty[i] * PWM_PERIOD / FADE_LEVEL_MAX;
+		uint16_t edge = time;
+		if(time > PWM_PERIOD / 2)
+			edge = PWM_PERIOD - time;
+		else if(time)
+			on |= masks[i];
+		if(!edge)
+		{
+			if(time)
+				on |= masks[i]; // on for the whole period
+			continue;
+		}
+
+		// sorted insert, equal edges share one segment
+		uint8_t j = 0;
+		while(j < count && edges[j] < edge)
+			j++;
+		if(j < count && edges[j] == edge)
+		{
+			edgeMasks[j] |= masks[i];
+			continue;
+		}
+		for(uint8_t k = count; k > j; k--)
+		{
+			edges[k] = edges[k - 1];
+			edgeMasks[k] = edgeMasks[k - 1];
+		}
+		edges[j] = edge;
+		edgeMasks[j] = masks[i];
+		count++;
+	}
+
+	uint16_t last = 0;
+	for(uint8_t i = 0; i < count; i++)
+	{
+		schedule[i].mask = on;
+		schedule[i].length = edges[i] - last;
+		on ^= edgeMasks[i];
+		last = edges[i];
+	}
+	schedule[count].mask = on;
+	schedule[count].length = PWM_PERIOD - last;
+	return count + 1;
+}
@@ -0,0 +1,32 @@
+// ==================================== [pwmEdges.h] =============================
+/*
+*	This library builds the edge schedule of the LED pwm, one period as a list of
+*	segments with the channels switched on and their duration in timer counts.
+*
+*	Author: Tobias Braechter
+*	Last update: 2020-06-21
+*
+*/
+
+#ifndef _PWM_EDGES_H_
+	#define _PWM_EDGES_H_ 1
+
+	#include <stdint.h>
+
+	#define PWM_CHANNELS 3 // red, green and blue
+	#define PWM_PERIOD 10000 // timer counts of one period, 1 MHz -> 10 ms
+	#define PWM_MIN_GAP 40 // shortest segment with an interrupt of its own, shorter ones are waited for
+	#define PWM_SEGMENTS (PWM_CHANNELS + 1) // every channel switches at its own edge
+
+	typedef struct
+	{
+		uint8_t mask; // LED channels switched on during the segment
+		uint16_t length; // duration of the segment in timer counts
+	} pwmSegment;
+
+	// builds the schedule for the given duty-cycles from 0 to FADE_LEVEL_MAX, masks are the
+	// port bits of the channels. Returns the number of segments, the last one is never
+	// shorter than PWM_MIN_GAP.
+	uint8_t pwmBuild(const uint16_t *duty, const uint8_t *masks, pwmSegment *schedule);
+
+#endif
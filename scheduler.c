@@ -0,0 +1,63 @@
+// ==================================== [scheduler.c] =============================
+/*
+*	This library runs periodic tasks cooperatively. The tasks are given as a table
+*	ordered by priority, each call runs the most important task that is due.
+*
+*	Author: Tobias Braechter
+*	Last update: 2020-06-21
+*
+*/
+
+#include "scheduler.h"
+
+uint8_t schedRun(schedTask *tasks, uint8_t count, uint16_t now, uint16_t tolerance)
+{
+	for(uint8_t i = 0; i < count; i++)
+	{
+		schedTask *task = &tasks[i];
+		uint16_t elapsed = now - task->last;
+		if(elapsed < task->period)
+			continue;
+
+		uint16_t late = elapsed - task->period;
+		if(late > task->lateMax)
+			task->lateMax = late;
+		if(late >= task->period)
+		{
+			// the task skipped at least one run, it is not caught up but restarted from now
+			task->last = now;
+			if(late >= tolerance && task->misses < SCHED_MAX_MISSES)
+				task->misses++;
+		}
+		else
+			task->last += task->period; // keeps the runs in step without drifting
+		task->run();
+		return 1;
+	}
+	return 0;
+}
+
+void schedStart(schedTask *tasks, uint8_t count, uint16_t now)
+{
+	for(uint8_t i = 0; i < count; i++)
+		tasks[i].last = now;
+}
+
+uint16_t schedLateMax(schedTask *tasks, uint8_t count)
+{
+	uint16_t result = 0;
+	for(uint8_t i = 0; i < count; i++)
+	{
+		if(tasks[i].lateMax > result)
+			result = tasks[i].lateMax;
+	}
+	return result;
+}
+
+uint16_t schedMisses(schedTask *tasks, uint8_t count)
+{
+	uint16_t result = 0;
+	for(uint8_t i = 0; i < count; i++)
+		result += tasks[i].misses;
+	return result;
+}
@@ -0,0 +1,41 @@
+// ==================================== [scheduler.h] =============================
+/*
+*	This library runs periodic tasks cooperatively. The tasks are given as a table
+*	ordered by priority, each call runs the most important task that is due.
+*
+*	Author: Tobias Braechter
+*	Last update: 2020-06-21
+*
+*/
+
+#ifndef _SCHEDULER_H_
+	#define _SCHEDULER_H_ 1
+
+	#include <stdint.h>
+
+	#define SCHED_MAX_MISSES 255 // the miss counter stops here
+
+	typedef struct
+	{
+		void (*run)(void); // task function
+		uint16_t period; // time between two runs in ticks
+		uint16_t last; // tick the task was last due
+		uint16_t lateMax; // longest delay between being due and running in ticks
+		uint8_t misses; // runs that were skipped because the task was late by a whole period
+	} schedTask;
+
+	// runs the first due task of the table, returns 1 if a task was run and 0 if none was due.
+	// A task later than its period is restarted from now, it only counts as missed if it is
+	// also later than tolerance, the longest time the caller may block the tasks.
+	uint8_t schedRun(schedTask *tasks, uint8_t count, uint16_t now, uint16_t tolerance);
+
+	// marks every task as due a full period after now
+	void schedStart(schedTask *tasks, uint8_t count, uint16_t now);
+
+	// returns the longest delay of all tasks
+	uint16_t schedLateMax(schedTask *tasks, uint8_t count);
+
+	// returns the skipped runs of all tasks
+	uint16_t schedMisses(schedTask *tasks, uint8_t count);
+
+#endif
@@ -12,7 +12,7 @@
 
 	#include <stdint.h>
 
-	#define NUM_OPT 17
+	#define NUM_OPT 18
 	#define OPT_NONE 0
 	#define OPT_LIGHT 1
 	#define OPT_DAY_HOUR 2
@@ -30,14 +30,16 @@
 	#define OPT_HOUR 14
 	#define OPT_MIN 15
 	#define OPT_CLOCK 16
+	#define OPT_RAMP 17
 
-	#define NUM_DAT 6
+	#define NUM_DAT 7
 	#define DAT_OPTION 0
 	#define DAT_TEMP 1
 	#define DAT_TEMP_OK 2
 	#define DAT_HYGRO 3
 	#define DAT_HYGRO_OK 4
 	#define DAT_DAYTIME 5
+	#define DAT_SCREEN 6
 
 	#define MAX_NONE 1
 	#define MAX_LIGHT 2
@@ -47,6 +49,7 @@
 	#define MAX_PWM 100
 	#define MAX_TEMP 50
 	#define MAX_CLOCK 200
+	#define MAX_RAMP 120
 
 	#define OPT_LIGHT_AUTO 0
 	#define OPT_LIGHT_ON 1
@@ -55,10 +58,34 @@
 	#define DAYTIME_DAY 0
 	#define DAYTIME_NIGHT 1
 
+	#define NUM_SCREENS 4
+	#define SCREEN_MAIN 0
+	#define SCREEN_LOG 1
+	#define SCREEN_GRAPH 2
+	#define SCREEN_DIAG 3
+
+	#define LOG_SIZE 4 // entries of the sensor log, all of them are visible
+	#define LOG_INVALID 255 // value of a failed sensor reading
+
+	#define HIST_SIZE 288 // samples of the sensor history, 24 hours
+	#define HIST_MINUTES 5 // minutes between two samples
+	#define HIST_MAX_TEMP 50 // samples are limited to the range of the graph
+	#define HIST_MAX_HYGRO 100
+
+	typedef struct
+	{
+		uint8_t hour; // time of the reading
+		uint8_t min;
+		uint8_t temp; // temperature in degree celsius or LOG_INVALID
+		uint8_t hygro; // humidity in percent or LOG_INVALID
+	} logEntry;
+
 	uint8_t options[NUM_OPT]; // current value of each option
-	uint8_t optionMax[NUM_OPT]; // maximum value of each option
 	uint8_t optionsCache[NUM_OPT]; // cache value of each option
 	uint8_t data[NUM_DAT]; // current data values
 	uint8_t dataCache[NUM_DAT]; // cache data values
+	logEntry sensorLog[LOG_SIZE]; // latest sensor readings
+	uint8_t histTemp[HIST_SIZE]; // temperature history in degree celsius or LOG_INVALID
+	uint8_t histHygro[HIST_SIZE]; // humidity history in percent or LOG_INVALID
 
 #endif